@@ -0,0 +1,92 @@
+#include <ivm/tuple.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+typedef std::chrono::high_resolution_clock ClockT;
+
+// The map used for relation entries before the flat hash map replaced it.
+typedef std::unordered_map<Tuple, LL, container_hash<Tuple> > NodeMap;
+
+
+/**
+ * Probe a map with every key in a list, a given number of times, and return the
+ * number of probes per second. The multiplicities found are summed and printed,
+ * so that the probes cannot be optimised away.
+ */
+template <typename Map>
+double probe_throughput(const Map &map, const std::vector<Tuple> &keys,
+    int rounds) {
+  LL total = 0;
+
+  auto t1 = ClockT::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (const auto &key : keys) {
+      auto it = map.find(key);
+      if (it != map.end()) {
+        total += it->second;
+      }
+    }
+  }
+  auto t2 = ClockT::now();
+
+  double seconds = std::chrono::duration<double>(t2 - t1).count();
+  std::cerr << "(checksum " << total << ") ";
+  return (double)keys.size() * rounds / seconds;
+}
+
+
+/**
+ * Fill both a node-based map and a flat hash map with the same random tuples of
+ * a given arity, then compare their probe throughput for keys that are found
+ * and for keys that are not.
+ */
+void run_benchmark(int arity, int num_tuples, int rounds, std::mt19937_64 &rng) {
+  std::uniform_int_distribution<LL> dist(1, 1000000);
+  NodeMap node_map;
+  TupleMap flat_map;
+
+  std::vector<Tuple> hits;
+  std::vector<Tuple> misses;
+  for (int i = 0; i < num_tuples; ++i) {
+    Tuple t(arity);
+    for (int j = 0; j < arity; ++j) {
+      t[j] = dist(rng);
+    }
+    node_map[t] += 1;
+    flat_map[t] += 1;
+    hits.push_back(t);
+
+    // Negative values never appear in the maps.
+    t[0] = -t[0];
+    misses.push_back(t);
+  }
+  std::shuffle(hits.begin(), hits.end(), rng);
+
+  double node_hits = probe_throughput(node_map, hits, rounds);
+  double flat_hits = probe_throughput(flat_map, hits, rounds);
+  double node_misses = probe_throughput(node_map, misses, rounds);
+  double flat_misses = probe_throughput(flat_map, misses, rounds);
+  std::cerr << "\n";
+
+  std::cout << "arity " << arity << ", " << num_tuples << " tuples (Mprobes/s)"
+      << "\n  hits:   unordered_map " << node_hits / 1e6 << ", flat "
+      << flat_hits / 1e6 << " (x" << flat_hits / node_hits << ")"
+      << "\n  misses: unordered_map " << node_misses / 1e6 << ", flat "
+      << flat_misses / 1e6 << " (x" << flat_misses / node_misses << ")\n";
+}
+
+
+int main(int argc, char **argv) {
+  int num_tuples = argc > 1 ? atoi(argv[1]) : 1000000;
+  int rounds = argc > 2 ? atoi(argv[2]) : 5;
+  std::mt19937_64 rng(42);
+
+  for (int arity = 2; arity < MAX_QUERY_ORDER; arity += 2) {
+    run_benchmark(arity, num_tuples, rounds, rng);
+  }
+}
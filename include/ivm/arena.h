@@ -0,0 +1,134 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+
+/**
+ * This class models a monotonic arena, which hands out memory by bumping a
+ * pointer through large chunks obtained from the operating system, optionally
+ * backed by huge pages. Individual deallocations are ignored: the memory is
+ * reclaimed all at once, either when the arena is reset, which keeps the chunks
+ * for reuse and takes O(1) time, or when it is destroyed.
+ *
+ * It is a std::pmr::memory_resource, so it can back relations and any standard
+ * polymorphic container holding short-lived data. Long-lived data, which is
+ * also freed, goes to a pool resource on top of a PageResource instead.
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises an empty arena, which allocates lazily.
+  Arena(bool huge_pages_ = false, std::size_t chunk_size_ = 1 << 21);
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // The destructor returns all chunks to the operating system.
+  ~Arena();
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Release everything allocated so far, keeping the chunks for reuse.
+  void reset();
+
+
+protected:
+  // Allocate memory from the current chunk, moving to a new one if needed.
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+  // Individual deallocations are no-ops in a monotonic arena.
+  void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept
+      override;
+
+
+private:
+  // A contiguous block of memory obtained from the operating system.
+  struct Chunk {
+    char *data;
+    std::size_t size;
+  };
+
+  // Whether to back the chunks with huge pages.
+  bool huge_pages;
+
+  // The size of the first chunk. Each new chunk is twice as big as the last.
+  std::size_t chunk_size;
+
+  // The chunks obtained so far, in the order in which they are used.
+  std::vector<Chunk> chunks;
+
+  // The index of the chunk currently allocated from.
+  std::size_t current;
+
+  // The next free byte and the end of the current chunk.
+  char *pos;
+  char *limit;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Obtain a chunk of at least the given size from the operating system.
+  Chunk map_chunk(std::size_t size);
+};
+
+
+/**
+ * This class models a memory resource which maps each allocation directly from
+ * the operating system, optionally backed by huge pages, and unmaps it when it
+ * is deallocated. It is meant to sit under a pool resource, which only passes
+ * it the large chunks the pool carves its blocks from and the blocks too large
+ * to pool, so freed memory goes back to the operating system rather than being
+ * held until the end of the process.
+ */
+class PageResource : public std::pmr::memory_resource {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises a resource mapping pages on each allocation.
+  PageResource(bool huge_pages_ = false);
+
+  PageResource(const PageResource &) = delete;
+  PageResource &operator=(const PageResource &) = delete;
+
+
+protected:
+  // Map the pages holding an allocation.
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+  // Unmap the pages holding an allocation.
+  void do_deallocate(void *p, std::size_t bytes, std::size_t alignment)
+      override;
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept
+      override;
+
+
+private:
+  // Whether to back the allocations of at least a huge page with huge pages.
+  bool huge_pages;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Get the size of the mapping holding an allocation of the given size.
+  std::size_t mapping_size(std::size_t bytes) const;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef _COLUMNKERNELS_H
+#define _COLUMNKERNELS_H
+
+#include <ivm/tuple.h>
+
+
+/**
+ * This class represents a collection of static kernels that scan whole columns
+ * of values, such as those of a relation stored in columnar form. Each kernel
+ * has an AVX2 version, used when the processor supports it, and a portable
+ * scalar version.
+ */
+class ColumnKernels {
+public:
+  // A column of values sorted in increasing order, and their multiplicities.
+  struct SortedColumn {
+    const Value *values;
+    const LL *mults;
+    std::size_t size;
+  };
+
+  // Return the sum of an array of multiplicities.
+  static LL sum(const LL *mults, std::size_t size);
+
+  /**
+   * Copy the first size values of each of count columns into the rows of a
+   * block of tuples, so that rows[j][i] holds columns[i][j]. The tuples must
+   * already have at least count attributes.
+   */
+  static void transpose(const Value *const *columns, int count, 
+      std::size_t size, Tuple *rows);
+
+  /**
+   * Intersect sorted columns, and return the sum over the values found in all
+   * of them of the products of their multiplicities.
+   */
+  static LL intersect_sum(std::vector<SortedColumn> &columns);
+
+  // Return true if the AVX2 versions of the kernels are used.
+  static bool has_avx2();
+
+
+private:
+  ColumnKernels() {}
+};
+
+#endif
@@ -15,7 +15,7 @@ public:
    * =========== */
 
   // The constructor initialises a delta processor for a query of order n.
-  DeltaProcessor(int n_);
+  DeltaProcessor(int n_, const Options &options_ = Options());
 
 
   /**
@@ -25,10 +25,34 @@ public:
   // Given an update to a relation, use delta processing to get the new count.
   LL update_and_count(int rel_num, const Tuple &t, int multiplicity);
 
+  // Given a batch of updates to a relation, process them as one delta.
+  LL update_and_count_batch(int rel_num, const UpdateBatch &batch);
+
 
 protected:
   // Keep track of the current query result.
   LL current_count;
+
+  /**
+   * For each relation, the number of the index of the next relation on the
+   * attributes they share, which is probed with updates to the relation.
+   */
+  std::vector<int> next_indexes;
+
+  /**
+   * For each relation r and each other relation k, the number of the sorted
+   * index of k on the attributes it shares with r, registered on first use
+   * when the matching values are found by intersection.
+   */
+  std::vector<std::vector<int> > sorted_indexes;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Count the join of an update tuple with the other relations by intersection.
+  LL intersect_count(int rel_num, const Tuple &t);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef _DICTIONARY_H
+#define _DICTIONARY_H
+
+#include <ivm/tuple.h>
+
+#include <functional>
+
+
+/**
+ * This class models a dictionary encoding of attribute values. Each attribute
+ * has its own dictionary, which maps the raw values found for it to dense IDs,
+ * assigned in order of first appearance starting from 0. Since an attribute is
+ * always encoded with the same dictionary, whichever relation it appears in,
+ * joins on the encoded values give the same results as on the raw ones.
+ */
+class Dictionary {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises empty dictionaries for the given relations.
+  Dictionary(const std::vector<Schema> &schemas);
+
+
+  /**
+   * Operations
+   * ========== */
+
+  /**
+   * Get the ID of a raw value found at a given position in the tuples of a
+   * given relation, assigning a new ID if the value has not been seen before.
+   */
+  Value encode(int rel_num, int attr_index, LL raw_val);
+
+
+private:
+  // For each relation, the dictionary used for each position in its schema.
+  std::vector<std::vector<int> > attr_ids;
+
+  // The dictionaries, one per attribute.
+  std::vector<FlatHashMap<LL, Value, std::hash<LL> > > dicts;
+};
+
+#endif
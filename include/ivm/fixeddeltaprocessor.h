@@ -0,0 +1,61 @@
+#ifndef _FIXEDDELTAPROCESSOR_H
+#define _FIXEDDELTAPROCESSOR_H
+
+#include <ivm/deltaprocessor.h>
+#include <ivm/fixedschema.h>
+
+#include <utility>
+
+
+/**
+ * This class models a delta processor specialised for a query of a fixed order
+ * N. The plans of updates to each relation are compile-time constants, so the
+ * loops building the keys and probing the relations have constant bounds and
+ * constant positions, and are unrolled by the compiler. The keys are arrays of
+ * N - 1 values, so hashing and comparing them is unrolled too. It is
+ * instantiated for each query order the build supports.
+ *
+ * With several threads, or when the matching values are found by intersection,
+ * updates go through the generic delta processor.
+ */
+template <int N>
+class FixedDeltaProcessor : public DeltaProcessor {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises a delta processor for a query of order N.
+  FixedDeltaProcessor(const Options &options_ = Options());
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Given an update to a relation, use delta processing to get the new count.
+  LL update_and_count(int rel_num, const Tuple &t, int multiplicity);
+
+
+private:
+  typedef LL (FixedDeltaProcessor::*UpdateFunction)(const Tuple &, int);
+
+  // The specialised update function of each relation.
+  std::array<UpdateFunction, N> update_functions;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Given an update to relation R, get the new count.
+  template <int R>
+  LL update_and_count_rel(const Tuple &t, int multiplicity);
+
+  // Get the specialised update function of each relation.
+  template <std::size_t... R>
+  static std::array<UpdateFunction, N> get_update_functions(
+      std::index_sequence<R...>);
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef _FIXEDSCHEMA_H
+#define _FIXEDSCHEMA_H
+
+#include <ivm/updateplan.h>
+
+#include <array>
+
+
+/**
+ * This struct derives, at compile time, the integer plans of updates to the
+ * relations of a query of a fixed order N, from the rule by which the schemas
+ * are built in the IVMProcessor constructor. Relation r has all attributes A1
+ * to AN except Ar (AN for relation 0), in sorted order, so the position of an
+ * attribute in a relation only depends on whether it comes before the missing
+ * one. The plans match those compiled at runtime by UpdatePlan.
+ */
+template <int N>
+struct FixedSchema {
+  static_assert(3 <= N && N <= MAX_QUERY_ORDER, "Unsupported query order");
+
+  // Get the number of the attribute missing from relation r.
+  static constexpr int missing_attr(int r) {
+    return r == 0 ? N : r;
+  }
+
+  // Get the position of attribute a in relation r, which must have it.
+  static constexpr int attr_position(int r, int a) {
+    return a < missing_attr(r) ? a - 1 : a - 2;
+  }
+
+  // Get the number of the attribute at position j in relation r.
+  static constexpr int attr_at(int r, int j) {
+    return j + 1 < missing_attr(r) ? j + 1 : j + 2;
+  }
+
+  /**
+   * For an update to relation r, get for each relation the position in the
+   * update tuple of each attribute of its key, or -1 for the missing attribute.
+   */
+  static constexpr std::array<std::array<int, N - 1>, N> key_positions(int r) {
+    std::array<std::array<int, N - 1>, N> positions{};
+    for (int i = 0; i < N; ++i) {
+      for (int j = 0; j < N - 1; ++j) {
+        int a = attr_at(i, j);
+        positions[i][j] = a == missing_attr(r) ? -1 : attr_position(r, a);
+      }
+    }
+    return positions;
+  }
+
+  /**
+   * For an update to relation r, get for each relation the position of the
+   * attribute missing from r in its key.
+   */
+  static constexpr std::array<int, N> missing_slots(int r) {
+    std::array<int, N> slots{};
+    for (int i = 0; i < N; ++i) {
+      slots[i] = i == r ? -1 : attr_position(i, missing_attr(r));
+    }
+    return slots;
+  }
+
+  /**
+   * For an update to relation r, get for each relation the positions in the
+   * update tuple of the attributes it shares with r, in its own order.
+   */
+  static constexpr std::array<std::array<int, N - 2>, N> shared_key_positions(
+      int r) {
+    std::array<std::array<int, N - 2>, N> positions{};
+    for (int i = 0; i < N; ++i) {
+      if (i == r) {
+        continue;
+      }
+      int k = 0;
+      for (int j = 0; j < N - 1; ++j) {
+        int a = attr_at(i, j);
+        if (a != missing_attr(r)) {
+          positions[i][k++] = attr_position(r, a);
+        }
+      }
+    }
+    return positions;
+  }
+
+  /**
+   * Return true if the plans compiled at runtime for the relations of a query
+   * of order N put the missing attribute in the same slots as derived here.
+   */
+  static bool matches(const std::vector<UpdatePlan> &plans) {
+    for (int r = 0; r < N; ++r) {
+      std::array<int, N> slots = missing_slots(r);
+      for (int i = 0; i < N; ++i) {
+        if (i != r && slots[i] != plans[r].get_missing_slot(i)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+};
+
+#endif
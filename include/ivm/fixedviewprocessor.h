@@ -0,0 +1,61 @@
+#ifndef _FIXEDVIEWPROCESSOR_H
+#define _FIXEDVIEWPROCESSOR_H
+
+#include <ivm/fixedschema.h>
+#include <ivm/viewprocessor.h>
+
+#include <utility>
+
+
+/**
+ * This class models a view processor specialised for a query of a fixed order
+ * N. The plans of updates to each relation are compile-time constants, so the
+ * loops maintaining the views have constant bounds and constant positions, and
+ * are unrolled by the compiler. The relations are probed with keys held in
+ * arrays of N - 1 values, so hashing and comparing them is unrolled too. It is
+ * instantiated for each query order the build supports.
+ *
+ * With several threads, or with views maintained lazily, updates go through
+ * the generic view processor.
+ */
+template <int N>
+class FixedViewProcessor : public ViewProcessor {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises a view processor for a query of order N.
+  FixedViewProcessor(const Options &options_ = Options());
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Given an update to a relation, use materialised views to get the new count.
+  LL update_and_count(int rel_num, const Tuple &t, int multiplicity);
+
+
+private:
+  typedef void (FixedViewProcessor::*UpdateFunction)(const Tuple &, int);
+
+  // The specialised view maintenance function of each relation.
+  std::array<UpdateFunction, N> update_functions;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Maintain the views after updating relation R.
+  template <int R>
+  void update_views_rel(const Tuple &t, int multiplicity);
+
+  // Get the specialised view maintenance function of each relation.
+  template <std::size_t... R>
+  static std::array<UpdateFunction, N> get_update_functions(
+      std::index_sequence<R...>);
+};
+
+#endif
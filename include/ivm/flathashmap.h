@@ -0,0 +1,516 @@
+#ifndef _FLATHASHMAP_H
+#define _FLATHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * This class models an open-addressing hash map in the style of SwissTable.
+ * Entries are stored inline in a flat array of slots, next to a parallel array
+ * of one-byte control words. A control word either marks its slot as empty or
+ * deleted, or holds 7 bits of the hash of the key stored in it.
+ *
+ * Slots are probed in groups of 16. The control words of a whole group are
+ * compared against the hash bits of the key at once (using SSE2 if available),
+ * so a lookup usually touches one cache line of control words and then goes
+ * straight to the slot holding the key, without chasing node pointers.
+ *
+ * The interface follows the subset of std::unordered_map used in the system.
+ * Like the std::pmr containers, the map allocates from a memory resource, which
+ * it keeps when moved but not when copied.
+ */
+template <typename Key, typename Value, typename Hash>
+class FlatHashMap {
+public:
+  typedef std::pair<Key, Value> value_type;
+
+
+  /**
+   * This class models an iterator over the entries of the map, which skips the
+   * empty and deleted slots.
+   */
+  template <bool IsConst>
+  class Iterator {
+  public:
+    typedef typename std::conditional<IsConst, const value_type,
+        value_type>::type entry_type;
+    typedef typename std::conditional<IsConst, const FlatHashMap,
+        FlatHashMap>::type map_type;
+
+    Iterator() : map(nullptr), idx(0) {}
+
+    Iterator(map_type *map_, std::size_t idx_) : map(map_), idx(idx_) {
+      skip_free_slots();
+    }
+
+    // Allow converting a mutable iterator into a const one.
+    Iterator(const Iterator<false> &other) : map(other.map), idx(other.idx) {}
+
+    entry_type &operator*() const { return map->slots[idx]; }
+    entry_type *operator->() const { return &map->slots[idx]; }
+
+    Iterator &operator++() {
+      idx++;
+      skip_free_slots();
+      return *this;
+    }
+
+    bool operator==(const Iterator &other) const { return idx == other.idx; }
+    bool operator!=(const Iterator &other) const { return idx != other.idx; }
+
+  private:
+    friend class FlatHashMap;
+    template <bool> friend class Iterator;
+
+    map_type *map;
+    std::size_t idx;
+
+    // Advance to the next slot holding an entry, or to the end of the map.
+    void skip_free_slots() {
+      while (idx < map->capacity && !is_full(map->ctrl[idx])) {
+        idx++;
+      }
+    }
+  };
+
+  typedef Iterator<false> iterator;
+  typedef Iterator<true> const_iterator;
+
+
+  /**
+   * Constructors
+   * ============ */
+
+  // Default constructor, which creates an empty map without allocating.
+  FlatHashMap() : FlatHashMap(std::pmr::get_default_resource()) {}
+
+  // Create an empty map which will allocate from the given memory resource.
+  explicit FlatHashMap(std::pmr::memory_resource *resource_) : ctrl(nullptr),
+      slots(nullptr), capacity(0), num_entries(0), num_deleted(0),
+      resource(resource_) {}
+
+  FlatHashMap(const FlatHashMap &other) : FlatHashMap() {
+    copy_from(other);
+  }
+
+  FlatHashMap(FlatHashMap &&other) noexcept : FlatHashMap() {
+    swap(other);
+  }
+
+  FlatHashMap &operator=(const FlatHashMap &other) {
+    if (this != &other) {
+      destroy();
+      copy_from(other);
+    }
+    return *this;
+  }
+
+  FlatHashMap &operator=(FlatHashMap &&other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  ~FlatHashMap() {
+    destroy();
+  }
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Get the value mapped to a key, inserting a default value if it is missing.
+  Value &operator[](const Key &key) {
+    return try_emplace(key).first->second;
+  }
+
+  /**
+   * Get the entry for a key, inserting it first with a value constructed from
+   * the given arguments if it is missing. The returned flag tells whether the
+   * entry was inserted.
+   */
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const Key &key, Args &&... args) {
+    std::size_t hash = hash_key(key);
+    std::size_t idx = find_index(key, hash);
+    bool inserted = idx == capacity;
+    if (inserted) {
+      idx = insert_index(hash);
+      new (&slots[idx]) value_type(std::piecewise_construct,
+          std::forward_as_tuple(key),
+          std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    return std::make_pair(iterator(this, idx), inserted);
+  }
+
+  // Find the entry for a key, or return end() if there is none.
+  iterator find(const Key &key) {
+    return iterator(this, find_index(key, hash_key(key)));
+  }
+
+  const_iterator find(const Key &key) const {
+    return const_iterator(this, find_index(key, hash_key(key)));
+  }
+
+  /**
+   * Find the entry for a key given as another type, which the hash function
+   * hashes as the equal key and which compares with keys, or return end().
+   */
+  template <typename K>
+  const_iterator find(const K &key) const {
+    return const_iterator(this, find_index(key, hash_key(key)));
+  }
+
+  // Return 1 if the key is in the map, or 0 otherwise.
+  std::size_t count(const Key &key) const {
+    return find_index(key, hash_key(key)) != capacity;
+  }
+
+  // Remove the entry for a key, and return the number of entries removed.
+  std::size_t erase(const Key &key) {
+    std::size_t idx = find_index(key, hash_key(key));
+    if (idx == capacity) {
+      return 0;
+    }
+    erase_index(idx);
+    return 1;
+  }
+
+  // Remove the entry an iterator points to, and return the following one.
+  iterator erase(const_iterator it) {
+    erase_index(it.idx);
+    return iterator(this, it.idx + 1);
+  }
+
+  // Remove all entries, keeping the allocated slots.
+  void clear() {
+    for (std::size_t i = 0; i < capacity; ++i) {
+      if (is_full(ctrl[i])) {
+        slots[i].~value_type();
+      }
+    }
+    if (capacity) {
+      std::memset(ctrl, EMPTY, capacity);
+    }
+    num_entries = 0;
+    num_deleted = 0;
+  }
+
+  // Make room for at least the given number of entries without rehashing.
+  void reserve(std::size_t n) {
+    if (n > max_load(capacity) - num_deleted) {
+      rehash(capacity_for(n));
+    }
+  }
+
+  void swap(FlatHashMap &other) noexcept {
+    std::swap(ctrl, other.ctrl);
+    std::swap(slots, other.slots);
+    std::swap(capacity, other.capacity);
+    std::swap(num_entries, other.num_entries);
+    std::swap(num_deleted, other.num_deleted);
+    std::swap(resource, other.resource);
+    std::swap(hasher, other.hasher);
+  }
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, capacity); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, capacity); }
+
+  // Get the number of entries in the map.
+  std::size_t size() const { return num_entries; }
+
+  // Return true if the map has no entries.
+  bool empty() const { return !num_entries; }
+
+  // Get the number of slots allocated for the map.
+  std::size_t bucket_count() const { return capacity; }
+
+  // Get the memory resource the map allocates from.
+  std::pmr::memory_resource *get_resource() const { return resource; }
+
+
+private:
+  // The number of slots probed together.
+  static const std::size_t GROUP_WIDTH = 16;
+
+  // Control words marking a free slot. Full slots hold 7 bits of the hash.
+  static const std::int8_t EMPTY = -128;
+  static const std::int8_t DELETED = -2;
+
+  // The control words of the slots, one per slot.
+  std::int8_t *ctrl;
+
+  // The slots, of which only those with a full control word are constructed.
+  value_type *slots;
+
+  // The number of slots, which is 0 or a power of 2 no smaller than a group.
+  std::size_t capacity;
+
+  // The number of entries in the map.
+  std::size_t num_entries;
+
+  // The number of slots freed by erasing entries, which do not end probes.
+  std::size_t num_deleted;
+
+  // The memory resource the slots and control words are allocated from.
+  std::pmr::memory_resource *resource;
+
+  Hash hasher;
+
+
+  /**
+   * This class models the control words of a group of slots, and matches them
+   * all at once against a given control word.
+   */
+  struct Group {
+#ifdef __SSE2__
+    __m128i words;
+
+    explicit Group(const std::int8_t *pos) {
+      words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+    }
+
+    // Get a bit mask of the slots whose control word is h2.
+    std::uint32_t match(std::int8_t h2) const {
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), words));
+    }
+
+    // Get a bit mask of the empty slots.
+    std::uint32_t match_empty() const {
+      return match(EMPTY);
+    }
+
+    // Get a bit mask of the empty or deleted slots, which have the sign bit set.
+    std::uint32_t match_free() const {
+      return _mm_movemask_epi8(words);
+    }
+#else
+    const std::int8_t *words;
+
+    explicit Group(const std::int8_t *pos) : words(pos) {}
+
+    std::uint32_t match(std::int8_t h2) const {
+      std::uint32_t mask = 0;
+      for (std::size_t i = 0; i < GROUP_WIDTH; ++i) {
+        mask |= (std::uint32_t)(words[i] == h2) << i;
+      }
+      return mask;
+    }
+
+    std::uint32_t match_empty() const {
+      return match(EMPTY);
+    }
+
+    std::uint32_t match_free() const {
+      std::uint32_t mask = 0;
+      for (std::size_t i = 0; i < GROUP_WIDTH; ++i) {
+        mask |= (std::uint32_t)(words[i] < 0) << i;
+      }
+      return mask;
+    }
+#endif
+  };
+
+
+  /**
+   * Operations
+   * ========== */
+
+  static bool is_full(std::int8_t c) {
+    return c >= 0;
+  }
+
+  // The maximum number of used slots before growing, i.e. a 7/8 load factor.
+  static std::size_t max_load(std::size_t cap) {
+    return cap - cap / 8;
+  }
+
+  // Get the smallest valid capacity that can hold n entries.
+  static std::size_t capacity_for(std::size_t n) {
+    std::size_t cap = GROUP_WIDTH;
+    while (max_load(cap) < n) {
+      cap *= 2;
+    }
+    return cap;
+  }
+
+  /**
+   * Hash a key and mix the result, so that both the low bits used to pick a
+   * group and the high bits stored in the control words are well distributed.
+   */
+  template <typename K>
+  std::size_t hash_key(const K &key) const {
+    std::uint64_t h = hasher(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  static std::int8_t h2_of(std::size_t hash) {
+    return hash >> (sizeof(std::size_t) * 8 - 7);
+  }
+
+  /**
+   * Get the slot holding a key, or the capacity if the key is not in the map.
+   * Groups are probed in triangular order, which visits every group once since
+   * the number of groups is a power of 2.
+   */
+  template <typename K>
+  std::size_t find_index(const K &key, std::size_t hash) const {
+    if (!capacity) {
+      return 0;
+    }
+
+    std::size_t group_mask = capacity / GROUP_WIDTH - 1;
+    std::size_t group = hash & group_mask;
+    std::int8_t h2 = h2_of(hash);
+    for (std::size_t probe = 1; ; ++probe) {
+      Group g(ctrl + group * GROUP_WIDTH);
+      for (std::uint32_t mask = g.match(h2); mask; mask &= mask - 1) {
+        std::size_t idx = group * GROUP_WIDTH + __builtin_ctz(mask);
+        if (slots[idx].first == key) {
+          return idx;
+        }
+      }
+      if (g.match_empty()) {
+        return capacity;
+      }
+      group = (group + probe) & group_mask;
+    }
+  }
+
+  /**
+   * Claim a free slot for a new entry with the given hash, growing the map
+   * first if needed, and return its index. The slot is left unconstructed.
+   */
+  std::size_t insert_index(std::size_t hash) {
+    if (num_entries + num_deleted + 1 > max_load(capacity)) {
+      /**
+       * Grow if the map is genuinely full, or just clean up the deleted slots
+       * if they make up a large part of it.
+       */
+      if (num_entries + 1 > max_load(capacity) / 2) {
+        rehash(capacity_for(2 * (num_entries + 1)));
+      } else {
+        rehash(capacity);
+      }
+    }
+
+    std::size_t idx = find_free_index(hash);
+    if (ctrl[idx] == DELETED) {
+      num_deleted--;
+    }
+    ctrl[idx] = h2_of(hash);
+    num_entries++;
+    return idx;
+  }
+
+  // Get the first free slot in the probe sequence of a hash.
+  std::size_t find_free_index(std::size_t hash) const {
+    std::size_t group_mask = capacity / GROUP_WIDTH - 1;
+    std::size_t group = hash & group_mask;
+    for (std::size_t probe = 1; ; ++probe) {
+      std::uint32_t mask = Group(ctrl + group * GROUP_WIDTH).match_free();
+      if (mask) {
+        return group * GROUP_WIDTH + __builtin_ctz(mask);
+      }
+      group = (group + probe) & group_mask;
+    }
+  }
+
+  // Destroy the entry in a slot and mark the slot as deleted.
+  void erase_index(std::size_t idx) {
+    slots[idx].~value_type();
+    ctrl[idx] = DELETED;
+    num_entries--;
+    num_deleted++;
+  }
+
+  // Move all entries into a fresh array of slots with the given capacity.
+  void rehash(std::size_t new_capacity) {
+    std::int8_t *old_ctrl = ctrl;
+    value_type *old_slots = slots;
+    std::size_t old_capacity = capacity;
+
+    allocate(new_capacity);
+    for (std::size_t i = 0; i < old_capacity; ++i) {
+      if (is_full(old_ctrl[i])) {
+        std::size_t hash = hash_key(old_slots[i].first);
+        std::size_t idx = find_free_index(hash);
+        ctrl[idx] = h2_of(hash);
+        new (&slots[idx]) value_type(std::move(old_slots[i]));
+        old_slots[i].~value_type();
+      }
+    }
+    num_deleted = 0;
+
+    deallocate(old_ctrl, old_slots, old_capacity);
+  }
+
+  // Allocate empty slots and control words for the given capacity.
+  void allocate(std::size_t new_capacity) {
+    capacity = new_capacity;
+    ctrl = static_cast<std::int8_t *>(resource->allocate(capacity, 1));
+    slots = static_cast<value_type *>(resource->allocate(
+        capacity * sizeof(value_type), alignof(value_type)));
+    std::memset(ctrl, EMPTY, capacity);
+  }
+
+  void deallocate(std::int8_t *old_ctrl, value_type *old_slots,
+      std::size_t old_capacity) {
+    if (old_capacity) {
+      resource->deallocate(old_ctrl, old_capacity, 1);
+      resource->deallocate(old_slots, old_capacity * sizeof(value_type),
+          alignof(value_type));
+    }
+  }
+
+  // Destroy all entries and release the slots.
+  void destroy() {
+    clear();
+    deallocate(ctrl, slots, capacity);
+    ctrl = nullptr;
+    slots = nullptr;
+    capacity = 0;
+  }
+
+  // Copy the entries of another map, slot for slot.
+  void copy_from(const FlatHashMap &other) {
+    hasher = other.hasher;
+    if (!other.capacity) {
+      return;
+    }
+
+    allocate(other.capacity);
+    std::memcpy(ctrl, other.ctrl, capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+      if (is_full(ctrl[i])) {
+        new (&slots[i]) value_type(other.slots[i]);
+      }
+    }
+    num_entries = other.num_entries;
+    num_deleted = other.num_deleted;
+  }
+};
+
+#endif
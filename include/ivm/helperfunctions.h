@@ -1,6 +1,7 @@
 #ifndef _HELPERFUNCTIONS_H
 #define _HELPERFUNCTIONS_H
 
+#include <ivm/options.h>
 #include <ivm/relation.h>
 
 
@@ -10,11 +11,6 @@
  */
 class HelperFunctions {
 public:
-  // Return one tuple for each relation filled with values from a given tuple.
-  static std::vector<std::pair<Tuple, int> > generate_keys(
-      const std::vector<Relation> &rels, const Tuple &vals, 
-      int excluded_rel_num, const std::string &excluded_attr);
-
   // Return the next partition configuration for a given number of relations.
   static std::vector<bool> get_next_config(const std::vector<bool> &config,
       int skip_idx);
@@ -28,6 +24,9 @@ public:
   // Validate the command line arguments passed to the system.
   static bool validate_arguments(int argc, char **argv);
 
+  // Get the optional settings given on the command line.
+  static Options parse_options(int argc, char **argv);
+
 
 private:
   HelperFunctions() {}
@@ -0,0 +1,88 @@
+#ifndef _HIGHERORDERPROCESSOR_H
+#define _HIGHERORDERPROCESSOR_H
+
+#include <ivm/ivmprocessor.h>
+
+
+/**
+ * This class models a higher-order IVM processor, which materialises views of
+ * two orders, and maintains each of them with the deltas of the order below.
+ *
+ * The first-order view of a relation is the join of all other relations,
+ * aggregated by the attributes of the relation, so an update to a relation
+ * changes the count by a single lookup in its view. The second-order view of
+ * a pair of relations is the join of all other relations, on all attributes.
+ * An update to one relation of the pair changes the first-order view of the
+ * other one by the tuples of the second-order view it matches, which are found
+ * through an index rather than by trying every value of the missing attribute.
+ * In turn, the second-order views are maintained by delta processing, with the
+ * candidate values taken from the smallest matching index bucket.
+ *
+ * For a query of order 3, the second-order views are the base relations.
+ */
+class HigherOrderProcessor : public IVMProcessor {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises a higher-order processor for a query of order n.
+  HigherOrderProcessor(int n_, const Options &options_ = Options());
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Given an update to a relation, use higher-order views to get the new count.
+  LL update_and_count(int rel_num, const Tuple &t, int multiplicity);
+
+
+protected:
+  // Keep track of the current query result.
+  LL current_count;
+
+  // The first-order view of each relation.
+  std::vector<Relation> views;
+
+  // The materialised second-order views, and the pair of relations of each.
+  std::vector<Relation> pair_views;
+  std::vector<std::pair<int, int> > pairs;
+
+  /**
+   * For each relation r and each other relation j, the second-order view of r
+   * and j, the number of its index on all its attributes except the one missing
+   * from j, and the positions in an update tuple of j of the index's key.
+   */
+  std::vector<std::vector<Relation *> > pair_view_of;
+  std::vector<std::vector<int> > pair_view_indexes;
+  std::vector<std::vector<std::vector<int> > > pair_view_key_positions;
+
+  /**
+   * For each relation j and each other relation k, the number of the index of
+   * k on its attributes shared with j.
+   */
+  std::vector<std::vector<int> > rel_indexes;
+
+  /**
+   * For each relation j, the position in an update tuple of j of each attribute
+   * of the query, or -1 for the one missing from j, and the position of that
+   * one among all attributes.
+   */
+  std::vector<std::vector<int> > full_positions;
+  std::vector<int> full_missing_slots;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Maintain a second-order view after an update to a relation not in it.
+  void update_pair_view(int pair_num, int rel_num, const Tuple &t,
+      int multiplicity);
+
+  // Get a key made of the values of a tuple at the given positions.
+  static Tuple project(const Tuple &t, const std::vector<int> &positions);
+};
+
+#endif
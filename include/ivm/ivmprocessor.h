@@ -1,7 +1,15 @@
 #ifndef _IVMPROCESSOR_H
 #define _IVMPROCESSOR_H
 
+#include <ivm/arena.h>
+#include <ivm/options.h>
 #include <ivm/relation.h>
+#include <ivm/threadpool.h>
+#include <ivm/updateplan.h>
+
+
+// A batch of updates to a relation, made of tuples and their multiplicities.
+typedef std::vector<std::pair<Tuple, int> > UpdateBatch;
 
 
 /**
@@ -14,11 +22,11 @@ public:
 	 * Constructors
 	 * ============ */
 
-  // Default constructor.
-  IVMProcessor() {}
-
 	// The constructor initialises an IVM processor for a query of order n.
-  IVMProcessor(int n_);
+  IVMProcessor(int n_, const Options &options_ = Options());
+
+  // Virtual destructor, so derived processors are destroyed entirely.
+  virtual ~IVMProcessor() {}
 
 
   /**
@@ -28,19 +36,56 @@ public:
   // Given an update to a relation, compute and return the new count.
   virtual LL update_and_count(int rel_num, const Tuple &t, int multiplicity);
 
+  // Given a batch of updates to a relation, compute and return the new count.
+  virtual LL update_and_count_batch(int rel_num, const UpdateBatch &batch);
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  // Get the schema of a given relation.
+  const Schema &get_schema(int rel_num) const;
+
 
 protected:
 	// The query order.
   int n;
+  // The optional settings the processor was created with.
+  Options options;
+
+  /**
+   * The long-lived relations and views are allocated from a pool, which
+   * recycles freed blocks, on top of pages mapped and unmapped as the pool
+   * needs them, so the arrays freed when hash maps grow are given back.
+   * Temporary relations built while processing an update are allocated from
+   * an arena, which is reset before each update, freeing them all at once.
+   */
+  PageResource storage_pages;
+  std::pmr::unsynchronized_pool_resource storage_pool;
+  Arena scratch_arena;
+
+  // The threads which large joins are split between.
+  ThreadPool pool;
+
   // The relations involved in the query.
   std::vector<Relation> rels;
 
+  // The plan of how updates to each relation are joined with the others.
+  std::vector<UpdatePlan> plans;
+  // The keys of the relations, filled from an update tuple by its plan.
+  std::vector<Tuple> keys;
+
   /**
    * Operations
    * ========== */
 
   // Perform an update to a specified relation.
-  void update_rel(int rel_num, const Tuple &t, int multiplicity);
+  void update_rel(int rel_num, const Tuple &t, LL multiplicity);
+
+  // Merge a batch of updates to a relation into a delta relation.
+  Relation coalesce_batch(int rel_num, const UpdateBatch &batch, 
+      std::pmr::memory_resource *resource);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef _JOINPLANNER_H
+#define _JOINPLANNER_H
+
+#include <ivm/relation.h>
+
+
+/**
+ * This class models a cost-based planner for the chain of binary joins which
+ * re-evaluates the query. Each join in the chain probes the index of the next
+ * relation with the result so far, aggregated by the attributes of the
+ * relations joined after it, and the last join only counts its result.
+ *
+ * The planner picks the order of the relations which minimises the estimated
+ * number of probes and intermediate tuples, by dynamic programming over the
+ * subsets of relations. The sizes of intermediate results are estimated from
+ * the cardinalities and the numbers of distinct values of the relations, which
+ * must keep statistics. A plan is kept until the size of a relation drifts too
+ * far from the one it was made for.
+ */
+class JoinPlanner {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises a planner with no plan.
+  JoinPlanner() {}
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Pick the order in which to join the relations, from their statistics.
+  const std::vector<int> &plan(const std::vector<Relation> &rels);
+
+  // Return true if the relations drifted enough from the plan to re-plan.
+  bool needs_replan(const std::vector<Relation> &rels) const;
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  // Get the order picked by the last plan.
+  const std::vector<int> &get_order() const;
+
+
+private:
+  // The order picked by the last plan.
+  std::vector<int> order;
+
+  // The sizes of the relations when the last plan was made.
+  std::vector<std::size_t> planned_sizes;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Estimate the size of the aggregated join of a subset of the relations.
+  double estimate_size(const std::vector<Relation> &rels,
+      unsigned int subset) const;
+};
+
+#endif
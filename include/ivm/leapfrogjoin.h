@@ -0,0 +1,53 @@
+#ifndef _LEAPFROGJOIN_H
+#define _LEAPFROGJOIN_H
+
+#include <ivm/relation.h>
+
+
+/**
+ * This class models a leapfrog triejoin, a worst-case optimal multiway join.
+ * Instead of joining the relations two at a time, it binds the attributes one
+ * after the other in sorted order, and for each attribute, it intersects the
+ * values found for it in all the relations that contain it, given the values
+ * bound so far. Its running time is bounded by the largest possible size of the
+ * join result (the AGM bound), up to a logarithmic factor, and it never builds
+ * intermediate results.
+ *
+ * Every relation must have a trie index registered, whose attribute order, the
+ * sorted schema, agrees with the sorted order of all the attributes.
+ */
+class LeapfrogJoin {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor prepares the join of the given relations.
+  LeapfrogJoin(const std::vector<Relation> &rels);
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Count the tuples in the join, as given by the sum of all multiplicities.
+  LL count();
+
+
+private:
+  // An iterator over the trie index of each relation.
+  std::vector<TrieIndex::Iterator> iters;
+
+  // For each attribute, in order, the relations which contain it.
+  std::vector<std::vector<int> > participants;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Count the join tuples extending the values bound to the first attributes.
+  LL count_from(int depth);
+};
+
+#endif
@@ -2,11 +2,13 @@
 #define _NAIVEPROCESSOR_H
 
 #include <ivm/ivmprocessor.h>
+#include <ivm/joinplanner.h>
 
 
 /**
  * This class models a naive processor, which simply re-evaluates the query
- * after each update.
+ * after each update, either with a chain of binary joins that only keep the
+ * multiplicities needed to count the result, or with a leapfrog triejoin.
  */
 class NaiveProcessor : public IVMProcessor {
 public:
@@ -15,7 +17,7 @@ public:
    * =========== */
 
   // The constructor initialises a naive processor for a query of order n.
-  NaiveProcessor(int n_);
+  NaiveProcessor(int n_, const Options &options_ = Options());
 
 
   /**
@@ -24,6 +26,31 @@ public:
 
   // Given an update to a relation, re-evaluate the query and get the new count.
   LL update_and_count(int rel_num, const Tuple &t, int multiplicity);
+
+  // Given a batch of updates to a relation, re-evaluate the query once.
+  LL update_and_count_batch(int rel_num, const UpdateBatch &batch);
+
+
+protected:
+  // The planner picking the order of the binary joins.
+  JoinPlanner planner;
+
+  /**
+   * For each binary join in the chain, the attributes its result is aggregated
+   * by, i.e. those of the relations joined after it.
+   */
+  std::vector<Schema> group_schemas;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Re-evaluate the query with the selected join engine, and get the count.
+  LL evaluate();
+
+  // Plan the order of the binary joins, and register the indexes they probe.
+  void plan_joins();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef _OPTIONS_H
+#define _OPTIONS_H
+
+#include <cstddef>
+
+
+// The algorithms which can re-evaluate the query from scratch.
+enum JoinEngine {
+  // A chain of binary hash joins (--engine=binary).
+  BINARY_JOIN,
+  // A worst-case optimal leapfrog triejoin (--engine=leapfrog).
+  LEAPFROG_JOIN
+};
+
+
+// The ways the delta processor can find the values matching an update.
+enum ProbeStrategy {
+  // Probe the other relations with a hash lookup per value (--probe=hash).
+  HASH_PROBE,
+  // Intersect sorted lists of the values in each relation (--probe=intersect).
+  INTERSECT_PROBE
+};
+
+
+/**
+ * This struct gathers the optional settings of the IVM system. Each of them can
+ * be changed with a flag of the form --name or --name=value, given on the
+ * command line after the mandatory arguments.
+ */
+struct Options {
+  // Back the storage of relations and views with huge pages (--huge-pages).
+  bool huge_pages = false;
+
+  /**
+   * Dictionary-encode attribute values into dense IDs on ingestion (--dict).
+   * This is always the case when the system is built with dense IDs.
+   */
+#ifdef IVM_DENSE_IDS
+  bool dense_ids = true;
+#else
+  bool dense_ids = false;
+#endif
+
+  // Store the base relations in columns rather than in maps (--columnar).
+  bool columnar = false;
+
+  // The algorithm used by the naive processor to re-evaluate the query.
+  JoinEngine engine = BINARY_JOIN;
+
+  // The way the delta processor finds the values matching an update.
+  ProbeStrategy probe = HASH_PROBE;
+
+  /**
+   * Log the updates for the views of the other relations, and only apply them
+   * when a view is read (--lazy).
+   */
+  bool lazy_views = false;
+
+  // The number of threads large joins are split between (--threads=K).
+  int threads = 1;
+
+  /**
+   * The number of values of the missing attribute from which the probes of a
+   * single update are also split between the threads (--parallel-threshold=K).
+   */
+  std::size_t parallel_threshold = 4096;
+
+  /**
+   * The number of updates processed together, with one line of output per batch
+   * (--batch=K), or 0 to process the updates one at a time.
+   */
+  int batch_size = 0;
+
+  /**
+   * The exponent of the relation size giving the skew threshold in skew mode
+   * (--epsilon=E), or a negative number to tune it while processing updates.
+   */
+  double epsilon = -1;
+};
+
+#endif
@@ -1,33 +1,29 @@
 #ifndef _RELATION_H
 #define _RELATION_H
 
+#include <ivm/columnkernels.h>
+#include <ivm/secondaryindex.h>
+#include <ivm/sortedindex.h>
+#include <ivm/threadpool.h>
+#include <ivm/trieindex.h>
+#include <ivm/valueset.h>
+
+#include <algorithm>
 #include <map>
-#include <unordered_map>
-#include <vector>
-
-#include <boost/functional/hash.hpp>
-
-
-// Define a generic hash function for containers such as vectors.
-template <typename Container>
-struct container_hash {
-  std::size_t operator()(Container const& c) const {
-    return boost::hash_range(c.begin(), c.end());
-  }
-};
-
-
-// Shorthand for the 64-bit integer data type used in all relations.
-typedef long long LL;
-// Shorthand for the schema of a relation, represented as an array of strings.
-typedef std::vector<std::string> Schema;
-// Shorthand for a tuple in a relation, represented as an array of numbers.
-typedef std::vector<LL> Tuple;
 
 
 /**
  * This class models a relation in uniform update representation, such that each
  * tuple is mapped to a multiplicity count.
+ *
+ * By default, the entries are stored in a hash map from tuples to counts. In
+ * columnar storage, they are stored instead as one contiguous array per
+ * attribute plus an array of multiplicities, with a hash map from tuples to
+ * their row IDs, so that operations over the whole relation become sequential
+ * scans of the arrays.
+ *
+ * Only tuples with non-zero multiplicity are stored: a tuple is removed as soon
+ * as its multiplicity drops to zero, so the storage tracks the live data.
  */
 class Relation {
 public:
@@ -36,51 +32,117 @@ public:
    * ============ */
 
   // Default constructor.
-  Relation() {}
+  Relation() : columnar(false), has_trie(false), has_statistics(false) {}
   
-  // The constructor simply initialises a new relation with the given schema.
-  Relation(const Schema &schema_);
+  /**
+   * The constructor simply initialises a new relation with the given schema,
+   * whose entries and indexes are allocated from the given memory resource,
+   * and stored either in a map or in columns.
+   */
+  Relation(const Schema &schema_, 
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+      bool columnar_ = false);
 
 
   /**
    * Operations
    * ========== */
 
+  // Register a secondary index on the given attributes, and get its number.
+  int add_index(const Schema &key_attrs);
+
+  // Register a sorted index on the given attributes, and get its number.
+  int add_sorted_index(const Schema &key_attrs);
+
+  // Register a trie index on the whole schema, kept up to date.
+  void add_trie_index();
+
+  // Remove all the secondary and sorted indexes registered on the relation.
+  void clear_indexes();
+
+  // Start keeping the distinct values of each attribute, for join planning.
+  void add_statistics(bool dense_ids = false);
+
   // Count the total number of tuples as given by the sum of all multiplicities.
   LL count() const;
 
-  // Join the relation with another, and return the resulting relation.
-  Relation join(const Relation &r);
+  /**
+   * Join the relation with another, and return the resulting relation. Large
+   * joins are split between the threads of the given pool, if any.
+   */
+  Relation join(const Relation &r, 
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+      ThreadPool *pool = nullptr);
 
-  // Update a tuple with a given multiplicity (or add it if it does not exist).
-  void update_tuple(const Tuple &t, int multiplicity);
+  // Join the relation with another, aggregating by the given attributes.
+  Relation join_group_by(const Relation &r, const Schema &group_attrs,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+      ThreadPool *pool = nullptr);
+
+  // Count the tuples in the join with another relation, without building it.
+  LL join_count(const Relation &r, ThreadPool *pool = nullptr) const;
+
+  /**
+   * Update a tuple with a given multiplicity (or add it if it does not exist),
+   * removing it if its multiplicity drops to zero.
+   */
+  void update_tuple(const Tuple &t, LL multiplicity);
 
   // Print a list of tuples in the relation and their multiplicities.
   void print_contents() const;
 
+  // Call f(t, multiplicity) for each tuple t with non-zero multiplicity.
+  template <typename F>
+  void for_each_entry(F f) const;
+
 
   /**
    * Accessors
    * ========= */
 
+  // Get the number of tuples with non-zero multiplicity in the relation.
+  std::size_t size() const;
+
   // Return true if the relation contains no tuples with non-zero multiplicity.
   bool empty() const;
 
-  // Get the entries in the relation as a map of tuples to multiplicities.
-  std::unordered_map<Tuple, LL, container_hash<Tuple> > get_entries() const;
+  // Get the entries as a map of tuples to multiplicities (not in columns).
+  const TupleMap &get_entries() const;
+
+  // Get the secondary index on the given attributes, or nullptr if none exists.
+  const SecondaryIndex *get_index(const Schema &key_attrs) const;
+
+  // Get the secondary index with the given number, as returned by add_index.
+  const SecondaryIndex &get_index(int index_num) const;
+
+  // Get the sorted index with the given number, from add_sorted_index.
+  const SortedIndex &get_sorted_index(int index_num) const;
+
+  // Get the number of distinct values of an attribute, if statistics are kept.
+  std::size_t get_distinct_count(int attr_index) const;
+
+  // Get the trie index, or nullptr if none exists.
+  const TrieIndex *get_trie_index() const;
 
   // Get the multiplicity of a given tuple.
   LL get_multiplicity(const Tuple &t) const;
 
+  // Get the multiplicity of a tuple given as a fixed-size array.
+  template <std::size_t L>
+  LL get_multiplicity(const std::array<Value, L> &t) const;
+
   // Get the schema of the relation.
-  Schema get_schema() const;
+  const Schema &get_schema() const;
 
   // Get the schema map of the relation.
-  std::map<std::string, int> get_schema_map() const;
+  const std::map<std::string, int> &get_schema_map() const;
 
   // Get the number of attributes in the relation.
   int get_schema_size() const;
 
+  // Return true if the relation is stored in columns.
+  bool is_columnar() const;
+
 
 protected:
   // The schema of the relation.
@@ -95,8 +157,85 @@ protected:
    */
   std::map<std::string, int> schema_map;
 
-  // The entries in the relation.
-  std::unordered_map<Tuple, LL, container_hash<Tuple> > entries;
+  // Whether the entries are stored in columns instead of in a map.
+  bool columnar;
+
+  // The entries in the relation, when not stored in columns.
+  TupleMap entries;
+
+  /**
+   * In columnar storage, the values of each attribute, the multiplicities, and
+   * the row in which each tuple is stored.
+   */
+  std::vector<std::pmr::vector<Value> > columns;
+  std::pmr::vector<LL> mults;
+  FlatHashMap<Tuple, std::size_t, container_hash<Tuple> > row_index;
+
+  // The secondary and sorted indexes registered on the relation.
+  std::vector<SecondaryIndex> indexes;
+  std::vector<SortedIndex> sorted_indexes;
+
+  // The trie index, if one is registered on the relation.
+  bool has_trie;
+  TrieIndex trie;
+
+  /**
+   * If statistics are kept, the values of each attribute in the tuples of the
+   * relation, whose sizes are the numbers of distinct values.
+   */
+  bool has_statistics;
+  std::vector<ValueSet> attr_values;
 };
 
+
+/**
+ * Call f for each tuple with non-zero multiplicity, and its multiplicity. In
+ * columnar storage, the tuples are assembled a block of rows at a time by
+ * transposing the columns of the block.
+ */
+template <typename F>
+void Relation::for_each_entry(F f) const {
+  if (!columnar) {
+    for (const auto &e : entries) {
+      f(e.first, e.second);
+    }
+    return;
+  }
+
+  const std::size_t BLOCK_SIZE = 64;
+  Tuple block[BLOCK_SIZE];
+  for (auto &t : block) {
+    t = Tuple(schema_size);
+  }
+  const Value *block_columns[MAX_QUERY_ORDER];
+  for (std::size_t start = 0; start < mults.size(); start += BLOCK_SIZE) {
+    std::size_t size = std::min(BLOCK_SIZE, mults.size() - start);
+    for (int i = 0; i < schema_size; ++i) {
+      block_columns[i] = columns[i].data() + start;
+    }
+    ColumnKernels::transpose(block_columns, schema_size, size, block);
+    for (std::size_t j = 0; j < size; ++j) {
+      f(block[j], mults[start + j]);
+    }
+  }
+}
+
+
+/**
+ * Get the multiplicity of a tuple given as a fixed-size array, as for a tuple,
+ * but hashing and comparing it in loops of constant length.
+ */
+template <std::size_t L>
+LL Relation::get_multiplicity(const std::array<Value, L> &t) const {
+  assert(L == schema.size());
+
+  if (columnar) {
+    auto row = row_index.find(t);
+    return row == row_index.end() ? 0 : mults[row->second];
+  }
+  auto it = entries.find(t);
+
+  return it == entries.end() ? 0 : it->second;
+}
+
 #endif
\ No newline at end of file
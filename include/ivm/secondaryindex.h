@@ -0,0 +1,97 @@
+#ifndef _SECONDARYINDEX_H
+#define _SECONDARYINDEX_H
+
+#include <ivm/tuple.h>
+
+
+/**
+ * This class models a secondary index on a subset of the attributes of a
+ * relation. Each key, made of the values of the indexed attributes, is mapped
+ * to the tuples of the remaining attributes found together with it in the
+ * relation, along with their multiplicities.
+ *
+ * The index is maintained incrementally by its relation, so probing it never
+ * requires a pass over the whole relation.
+ */
+class SecondaryIndex {
+public:
+  // Shorthand for the entries found under a single key of the index.
+  typedef TupleMap Bucket;
+
+
+  /**
+   * Constructor
+   * =========== */
+
+  /**
+   * The constructor initialises an empty index on the key attributes of a
+   * relation with the given schema, allocated from the given memory resource.
+   */
+  SecondaryIndex(const Schema &schema, const Schema &key_attrs_,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Update the index after a tuple's multiplicity changed in the relation.
+  void update_tuple(const Tuple &t, LL multiplicity);
+
+  // Get the entries matching a given key, or nullptr if there are none.
+  const Bucket *lookup(const Tuple &key) const;
+
+  // Get the entries matching a key given as a fixed-size array.
+  template <std::size_t L>
+  const Bucket *lookup(const std::array<Value, L> &key) const;
+
+  // Call f(key, bucket) for each key of the index and its bucket.
+  template <typename F>
+  void for_each_key(F f) const;
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  // Get the attributes the index is built on.
+  const Schema &get_key_attrs() const;
+
+  // Get the positions in the relation's schema of the non-key attributes.
+  const std::vector<int> &get_val_indices() const;
+
+
+private:
+  // The attributes the index is built on.
+  Schema key_attrs;
+
+  // The positions in the relation's schema of the key attributes.
+  std::vector<int> key_indices;
+
+  // The positions in the relation's schema of the remaining attributes.
+  std::vector<int> val_indices;
+
+  // The index entries, mapping each key to its bucket of remaining values.
+  FlatHashMap<Tuple, Bucket, container_hash<Tuple> > entries;
+};
+
+
+// Get the entries matching a key given as a fixed-size array, if any.
+template <std::size_t L>
+const SecondaryIndex::Bucket *SecondaryIndex::lookup(
+    const std::array<Value, L> &key) const {
+  auto it = entries.find(key);
+
+  return it == entries.end() ? nullptr : &it->second;
+}
+
+
+// Call f for each key of the index, and the entries matching it.
+template <typename F>
+void SecondaryIndex::for_each_key(F f) const {
+  for (const auto &e : entries) {
+    f(e.first, e.second);
+  }
+}
+
+#endif
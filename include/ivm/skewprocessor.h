@@ -3,20 +3,147 @@
 
 #include <ivm/ivmprocessor.h>
 #include <ivm/skewrelation.h>
+#include <ivm/view.h>
 
 
+// The exponent of the relation size above which the degree of a value is heavy.
 const double EPSILON = 0.5;
 
+// The range within which epsilon is tuned, and the step by which it changes.
+const double MIN_EPSILON = 0.2;
+const double MAX_EPSILON = 0.8;
+const double EPSILON_STEP = 0.1;
+
+// The number of updates after which epsilon is tuned again.
+const int TUNING_PERIOD = 4096;
+
+
+/**
+ * This class models an IVM processor which handles skew by partitioning each
+ * relation into heavy and light parts, as in IVM^epsilon. Relation r is
+ * partitioned on its first attribute in the order of the cycle, A(r + 1), so
+ * relation r - 1 is partitioned on the attribute A(r) missing from relation r.
+ *
+ * For an update to relation r, the values of the other partition attributes
+ * are fixed by the update tuple. If any of them is light, it matches at most
+ * N^epsilon tuples, which are enumerated as in delta processing. Otherwise,
+ * the heavy values of A(r) in relation r - 1 are enumerated, of which there are
+ * at most N^(1 - epsilon), and the light ones are covered by a view of relation
+ * r: the join of the light part of relation r - 1 with the heavy parts of the
+ * other relations, aggregated onto the attributes of relation r. The views are
+ * maintained within the same bounds, as each of them has a single light part.
+ *
+ * Unless epsilon is given, it starts at 0.5 and is tuned as updates come. The
+ * processor counts the values it goes through in the light path, from sets of
+ * matches, and in the heavy path, from heavy values. When one path has done
+ * more than twice the work of the other over a period, epsilon moves by a step
+ * to shift work to the other path, provided that the tuples moved to the other
+ * partitions would not outweigh the work it saves over a period.
+ */
 class SkewProcessor : public IVMProcessor {
 public:
-  SkewProcessor(int n_);
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises a skew processor for a query of order n.
+  SkewProcessor(int n_, const Options &options_ = Options());
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Given an update to a relation, compute and return the new count.
   LL update_and_count(int rel_num, const Tuple &t, int multiplicity);
-  LL delta_update(int rel_num, const Tuple &t, int multiplicity,
-    int next_rel_num, const std::vector<bool> &skew_config);
+
+  // Given a batch of updates to a relation, compute and return the new count.
+  LL update_and_count_batch(int rel_num, const UpdateBatch &batch);
+
 
 private:
+  // The relations, partitioned on their first attributes in the cycle.
   std::vector<SkewRelation> skew_rels;
+
+  /**
+   * The view of each relation, joining the light part of the previous relation
+   * with the heavy parts of the others.
+   */
+  std::vector<View> views;
+
+  /**
+   * The number of the index of each relation on the attributes it shares with
+   * each other one, i.e. on all its attributes but the one missing from the
+   * other relation.
+   */
+  std::vector<std::vector<int> > shared_indexes;
+
+  /**
+   * The position in the tuples of each relation of the partition attribute of
+   * each relation, or -1 if it is the attribute missing from them.
+   */
+  std::vector<std::vector<int> > skew_positions;
+
+  // The values whose tuples moved to the other part after the current update.
+  std::vector<Value> moved_values;
+
+  // The tuples of each relation matching the current update, if any.
+  std::vector<const SecondaryIndex::Bucket *> matches;
+
+  // Where the values maintaining each view are taken from, for an update.
+  std::vector<int> view_sources;
+
+  // The current result of the query.
   LL current_count;
+
+  // The exponent of the relation sizes giving the skew thresholds.
+  double epsilon;
+
+  /**
+   * The numbers of values gone through in the light and heavy paths, and of
+   * updates processed, since epsilon was last tuned.
+   */
+  LL light_work;
+  LL heavy_work;
+  int tuning_updates;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Fill the keys of the other relations, and find their tuples matching t.
+  void find_matches(int rel_num, const Tuple &t);
+
+  // Get the change of the count caused by an update to a relation.
+  LL get_delta_count(int rel_num, const Tuple &t, int multiplicity);
+
+  // Maintain the views after an update to a part of a relation.
+  void update_views(int rel_num, const Tuple &t, LL multiplicity, bool heavy);
+
+  // Get where to take the values maintaining a view from, if it changes.
+  int get_view_source(int rel_num, const Tuple &t, int view_num);
+
+  // Compute the change of a view, passing each of its tuples to f.
+  template <typename F>
+  void update_view(int view_num, int rel_num, int source, LL multiplicity,
+      std::vector<Tuple> &keys, F f) const;
+
+  // Maintain the views after the tuples of a value moved to the other part.
+  void migrate(int rel_num, Value val);
+
+  /**
+   * Multiply a count by the multiplicities of the given keys filled with a
+   * value of the missing attribute, in the relations other than the given ones.
+   */
+  LL probe(std::vector<Tuple> &keys, LL delta_count, Value v, int rel_num, 
+      int view_num, int candidate_rel_num) const;
+
+  // Move epsilon towards the path which has done less work, if it pays off.
+  void tune_epsilon();
+
+  // Get the partition value in a tuple of a relation of another relation.
+  Value get_skew_value(int rel_num, const Tuple &t, int skew_rel_num) const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,14 +3,30 @@
 
 #include <ivm/relation.h>
 
-#include <unordered_set>
-
 
 /**
  * This class models a skew-aware relation used for IVM with skew-sensitive
- * processing. It partitions its tuples in two regular relations, depending on
- * a given skew attribute and a threshold determined by the size of the relation
- * and a given value epsilon.
+ * processing. It partitions its tuples in two parts, depending on a given skew
+ * attribute and a threshold determined by the size of the relation and a given
+ * value epsilon: the tuples whose value of the skew attribute is found in more
+ * tuples than the threshold are heavy, and the others are light.
+ *
+ * All the tuples with the same value of the skew attribute are in the same
+ * partition, so a value is itself either heavy or light, and there are at most
+ * N^(1 - epsilon) heavy values. The tuples are stored once, as in any relation,
+ * and the partition is only a set of heavy values. The tuples of each value are
+ * found through an index on the skew attribute, whose buckets also give the
+ * degree of each value, so moving a value to the other partition only adds it
+ * to or removes it from the heavy values.
+ *
+ * The threshold is computed from the size M of the relation at the last major
+ * rebalance, and values only change partition once they are well past it: a
+ * light value becomes heavy when found in more than 2 * M^epsilon tuples, and a
+ * heavy value becomes light when found in fewer than M^epsilon / 2, so a value
+ * close to the threshold does not move back and forth. When the size doubles
+ * or halves, M is reset, and the values are checked against the new threshold
+ * a few at a time over the following updates, so that no update has to move
+ * the tuples of every value at once.
  */
 class SkewRelation : public Relation {
 public:
@@ -21,58 +37,126 @@ public:
   // Default constructor.
   SkewRelation() {}
 
-  // The constructor gets the skew criteria and initialises the partitions.
+  /**
+   * The constructor gets the skew criteria and initialises the relation, which
+   * is allocated from the given memory resource, and stored either in a map or
+   * in columns. The heavy values are kept in a direct-indexed set if the values
+   * are dense IDs.
+   */
   SkewRelation(const Schema &schema_, const std::string &skew_attr_, 
-      double epsilon_);
+      double epsilon_, bool dense_ids = false,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+      bool columnar_ = false);
 
 
   /**
    * Operations
    * ========== */
 
-  // Print the heavy partition.
-  void print_heavy_contents() const;
+  /**
+   * Update a tuple and re-balance the partitions, adding the values whose
+   * tuples moved to the other partition to the given list.
+   */
+  void update_tuple(const Tuple &t, int multiplicity, 
+      std::vector<Value> &moved_values);
+
+  /**
+   * Change the exponent of the threshold, and start a major re-balance against
+   * the new threshold.
+   */
+  void set_epsilon(double epsilon_);
 
-  // Print the light partition.
-  void print_light_contents() const;
+  /**
+   * Count the tuples which a major re-balance at the current size would move
+   * to the other partition, with the given exponent of the threshold.
+   */
+  std::size_t count_moved_tuples(double new_epsilon) const;
 
-  // Update a tuple and re-balance its related tuples.
-  void update_tuple(const Tuple &t, int multiplicity);
+  // Call f(t, multiplicity) for each tuple t with a given skew value.
+  template <typename F>
+  void for_each_value_tuple(Value val, F f) const;
 
 
   /**
    * Accessors
    * ========= */
 
-  // Return the heavy partition.
-  Relation get_heavy_part() const;
+  // Return true if a value of the skew attribute is heavy.
+  bool is_heavy(Value val) const;
 
-  // Return the light partition.
-  Relation get_light_part() const;
+  // Get the heavy values of the skew attribute.
+  const ValueSet &get_heavy_values() const;
 
+  // Get the number of tuples a value of the skew attribute is found in.
+  std::size_t get_degree(Value val) const;
+
+  // Get the exponent of the threshold.
+  double get_epsilon() const;
 
-private:
-  // The current number of tuples in the relation.
-  int N;
 
+private:
   // The index in the schema of the skew attribute.
   int skew_attr_idx;
 
+  // The number of the index on the skew attribute.
+  int skew_index;
+
   double epsilon;
-  Relation light_part;
-  Relation heavy_part;
-  
-  // Store for each value of the skew attribute the tuples in which it is found.
-  std::unordered_map<LL, std::unordered_set<Tuple, container_hash<Tuple> > > 
-      skew_tuples;
+
+  /**
+   * The size of the relation at the last major rebalance, and the numbers of
+   * tuples above which a light value becomes heavy, and below which a heavy
+   * value becomes light.
+   */
+  std::size_t base_size;
+  double heavy_threshold;
+  double light_threshold;
+
+  // The values not yet checked against the threshold since it was last reset.
+  std::pmr::vector<Value> unchecked_values;
+
+  // The values of the skew attribute whose tuples are in the heavy partition.
+  ValueSet heavy_values;
 
 
   /**
    * Operations
    * ========== */
 
-  // Re-balance the partitions after a given update in a given partition.
-  void rebalance(LL val, bool in_light);
+  // Re-balance the tuples of a value, and get whether they were moved.
+  bool rebalance(Value val);
+
+  // Reset the threshold to the current size, and start checking every value.
+  void start_major_rebalance();
+
+  // Check a few of the values left since the last major re-balance.
+  void continue_major_rebalance(std::vector<Value> &moved_values);
 };
 
-#endif
\ No newline at end of file
+
+/**
+ * Call f for each tuple with a given value of the skew attribute, and its
+ * multiplicity, rebuilding the tuple from its entry in the skew index.
+ */
+template <typename F>
+void SkewRelation::for_each_value_tuple(Value val, F f) const {
+  const SecondaryIndex &index = get_index(skew_index);
+  Tuple key(1);
+  key[0] = val;
+  const SecondaryIndex::Bucket *bucket = index.lookup(key);
+  if (!bucket) {
+    return;
+  }
+
+  const std::vector<int> &val_indices = index.get_val_indices();
+  Tuple t(schema_size);
+  t[skew_attr_idx] = val;
+  for (const auto &e : *bucket) {
+    for (int i = 0; i < val_indices.size(); ++i) {
+      t[val_indices[i]] = e.first[i];
+    }
+    f(t, e.second);
+  }
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef _SORTEDINDEX_H
+#define _SORTEDINDEX_H
+
+#include <ivm/tuple.h>
+
+
+/**
+ * This class models an index on all the attributes of a relation but one. Each
+ * key, made of the values of the indexed attributes, is mapped to the values of
+ * the remaining attribute found together with it in the relation, kept sorted,
+ * along with their multiplicities in a parallel array. The lists of different
+ * relations can then be intersected with a merge instead of hash lookups.
+ *
+ * The index is maintained incrementally by its relation.
+ */
+class SortedIndex {
+public:
+  // The values found under a single key of the index, and their multiplicities.
+  struct Bucket {
+    std::pmr::vector<Value> values;
+    std::pmr::vector<LL> mults;
+
+    Bucket(std::pmr::memory_resource *resource) : values(resource),
+        mults(resource) {}
+  };
+
+
+  /**
+   * Constructor
+   * =========== */
+
+  /**
+   * The constructor initialises an empty index on the key attributes of a
+   * relation with the given schema, which must leave out a single attribute.
+   */
+  SortedIndex(const Schema &schema, const Schema &key_attrs_,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Update the index after a tuple's multiplicity changed in the relation.
+  void update_tuple(const Tuple &t, LL multiplicity);
+
+  // Get the values matching a given key, or nullptr if there are none.
+  const Bucket *lookup(const Tuple &key) const;
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  // Get the attributes the index is built on.
+  const Schema &get_key_attrs() const;
+
+
+private:
+  // The attributes the index is built on.
+  Schema key_attrs;
+
+  // The positions in the relation's schema of the key attributes.
+  std::vector<int> key_indices;
+
+  // The position in the relation's schema of the remaining attribute.
+  int val_index;
+
+  // The index entries, mapping each key to its sorted bucket of values.
+  FlatHashMap<Tuple, Bucket, container_hash<Tuple> > entries;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * This class models a fixed pool of worker threads, which run batches of
+ * independent tasks. The thread submitting a batch works on it too, so a pool
+ * of k threads starts k - 1 workers, and a pool of one thread runs every task
+ * in the calling thread.
+ */
+class ThreadPool {
+public:
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor starts the workers of a pool of the given size.
+  ThreadPool(int num_threads = 1);
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // The destructor stops and joins the workers.
+  ~ThreadPool();
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Call f(i) for each i in [0, num_tasks) on the pool, and wait for all calls.
+  void parallel_for(int num_tasks, const std::function<void(int)> &f);
+
+  // Split [0, size) into chunks, and call f(chunk, begin, end) for each one.
+  void parallel_for_chunks(std::size_t size, 
+      const std::function<void(int, std::size_t, std::size_t)> &f);
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  // Get the number of threads in the pool, including the calling thread.
+  int size() const;
+
+  // Get the number of chunks a range is split into by parallel_for_chunks.
+  int get_num_chunks() const;
+
+
+private:
+  // The worker threads.
+  std::vector<std::thread> workers;
+
+  // The current batch, and the index of the next task to run in it.
+  const std::function<void(int)> *task;
+  int num_tasks;
+  std::atomic<int> next_task;
+
+  /**
+   * The number of workers still busy with the current batch, and the number of
+   * batches submitted so far, which tells the workers when a new one starts.
+   */
+  int busy;
+  unsigned int batch;
+  bool stopping;
+
+  std::mutex mutex;
+  std::condition_variable batch_ready;
+  std::condition_variable batch_done;
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Wait for batches and work on them, until the pool is destroyed.
+  void work();
+
+  // Run tasks from the current batch until there are none left.
+  void run_tasks();
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef _TRIEINDEX_H
+#define _TRIEINDEX_H
+
+#include <ivm/tuple.h>
+
+
+/**
+ * This class models a trie index on a relation, used by the leapfrog triejoin.
+ * The tuples are kept in lexicographic order in a contiguous array, along with
+ * their multiplicities, so each node of the trie at depth d is a range of rows
+ * which agree on their first d values, sorted by their value at depth d.
+ *
+ * The index is maintained incrementally by its relation. An update costs a
+ * binary search, plus moving the following rows when a tuple appears or
+ * disappears.
+ */
+class TrieIndex {
+public:
+  /**
+   * This class models an iterator over the trie, which walks down one level at
+   * a time, and visits the distinct values at each level in sorted order.
+   */
+  class Iterator {
+  public:
+    // Create an iterator at the root of the trie, above the first level.
+    Iterator(const TrieIndex *trie_ = nullptr);
+
+    // Go down to the first value at the next level, under the current value.
+    void open();
+
+    // Go back up to the value at the previous level.
+    void up();
+
+    // Move to the next distinct value at the current level.
+    void next();
+
+    // Move to the first value at the current level that is at least v.
+    void seek(Value v);
+
+    // Return true if there are no more values at the current level.
+    bool at_end() const;
+
+    // Get the current value.
+    Value key() const;
+
+    // Get the multiplicity of the current tuple, once all levels are open.
+    LL multiplicity() const;
+
+
+  private:
+    // The trie being iterated over.
+    const TrieIndex *trie;
+
+    // The current level, or -1 at the root.
+    int depth;
+
+    // The current row, and the end of the current node's range, per level.
+    std::size_t pos[MAX_QUERY_ORDER];
+    std::size_t end[MAX_QUERY_ORDER];
+
+
+    // Get the first row in [from, end) whose value at depth is greater than v.
+    std::size_t upper_bound(std::size_t from, Value v) const;
+  };
+
+
+  /**
+   * Constructor
+   * =========== */
+
+  // The constructor initialises an empty trie, allocated from the resource.
+  TrieIndex(std::pmr::memory_resource *resource =
+      std::pmr::get_default_resource());
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Update the trie after a tuple's multiplicity changed in the relation.
+  void update_tuple(const Tuple &t, LL multiplicity);
+
+  // Get an iterator at the root of the trie.
+  Iterator root() const;
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  // Return true if the trie contains no tuples.
+  bool empty() const;
+
+
+private:
+  // The tuples in lexicographic order, and their multiplicities.
+  std::pmr::vector<Tuple> tuples;
+  std::pmr::vector<LL> mults;
+};
+
+#endif
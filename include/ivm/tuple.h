@@ -0,0 +1,174 @@
+#ifndef _TUPLE_H
+#define _TUPLE_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include <ivm/flathashmap.h>
+
+
+// Shorthand for the 64-bit integer data type used in all relations.
+typedef long long LL;
+
+/**
+ * The data type of attribute values. When the system is built with dense IDs,
+ * all values are dictionary-encoded into 32-bit IDs on ingestion, so tuples
+ * take half the space. Otherwise, values are stored as they are read.
+ */
+#ifdef IVM_DENSE_IDS
+typedef unsigned int Value;
+#else
+typedef LL Value;
+#endif
+
+/**
+ * The largest query order supported by the system. Join results contain one
+ * attribute per relation, so this is also the largest arity a tuple can have.
+ * Every tuple reserves room for this many values, whatever its arity, so it is
+ * set per build: with 64-bit values, a tuple takes 72 bytes in a build for up
+ * to 8 relations, but 32 bytes in a build for the triangle query alone.
+ */
+#ifndef IVM_MAX_QUERY_ORDER
+#define IVM_MAX_QUERY_ORDER 8
+#endif
+const int MAX_QUERY_ORDER = IVM_MAX_QUERY_ORDER;
+static_assert(MAX_QUERY_ORDER >= 3, "Queries have at least 3 relations");
+
+// Shorthand for the schema of a relation, represented as an array of strings.
+typedef std::vector<std::string> Schema;
+
+
+/**
+ * Define a generic hash function for containers such as tuples. It also hashes
+ * fixed-size arrays of values, to the same hash as tuples holding the same
+ * values, so that maps of tuples can be probed with keys of a length known at
+ * compile time, whose hashing loop is unrolled.
+ */
+template <typename Container>
+struct container_hash {
+  std::size_t operator()(Container const& c) const {
+    return boost::hash_range(c.begin(), c.end());
+  }
+
+  template <typename T, std::size_t L>
+  std::size_t operator()(std::array<T, L> const& a) const {
+    return boost::hash_range(a.begin(), a.end());
+  }
+};
+
+
+/**
+ * This class models a tuple of attribute values. The values are stored inline
+ * in a fixed-capacity array rather than on the heap, so building a tuple never
+ * allocates and a tuple stored in a hash table lives directly in its slot.
+ */
+class Tuple {
+public:
+  typedef Value value_type;
+  typedef Value *iterator;
+  typedef const Value *const_iterator;
+
+
+  /**
+   * Constructors
+   * ============ */
+
+  // Default constructor, which creates an empty tuple.
+  Tuple() : values(), length(0) {}
+
+  // Create a tuple with the given number of attributes, all set to 0.
+  explicit Tuple(std::size_t size_) : values(), length(size_) {
+    assert(size_ <= MAX_QUERY_ORDER);
+  }
+
+  // Create a tuple holding the values of a fixed-size array.
+  template <std::size_t L>
+  explicit Tuple(const std::array<Value, L> &a) : values(), length(L) {
+    static_assert(L <= MAX_QUERY_ORDER, "Tuple too long");
+
+    for (std::size_t i = 0; i < L; ++i) {
+      values[i] = a[i];
+    }
+  }
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Append a value to the end of the tuple.
+  void push_back(Value val) {
+    assert(length < MAX_QUERY_ORDER);
+
+    values[length++] = val;
+  }
+
+  // Compare two tuples attribute by attribute.
+  bool operator==(const Tuple &other) const {
+    if (length != other.length) {
+      return false;
+    }
+    for (std::size_t i = 0; i < length; ++i) {
+      if (values[i] != other.values[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const Tuple &other) const {
+    return !(*this == other);
+  }
+
+  // Compare the tuple with a fixed-size array, in a loop of constant length.
+  template <std::size_t L>
+  bool operator==(const std::array<Value, L> &a) const {
+    if (length != L) {
+      return false;
+    }
+    for (std::size_t i = 0; i < L; ++i) {
+      if (values[i] != a[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  Value &operator[](std::size_t i) { return values[i]; }
+  const Value &operator[](std::size_t i) const { return values[i]; }
+
+  iterator begin() { return values; }
+  iterator end() { return values + length; }
+  const_iterator begin() const { return values; }
+  const_iterator end() const { return values + length; }
+
+  // Get the number of attributes in the tuple.
+  std::size_t size() const { return length; }
+
+  // Return true if the tuple has no attributes.
+  bool empty() const { return !length; }
+
+
+private:
+  // The attribute values, of which only the first length are in use.
+  Value values[MAX_QUERY_ORDER];
+
+  // The number of attributes in the tuple.
+  unsigned char length;
+};
+
+
+// Shorthand for a map of tuples to their multiplicities.
+typedef FlatHashMap<Tuple, LL, container_hash<Tuple> > TupleMap;
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef _UPDATEPLAN_H
+#define _UPDATEPLAN_H
+
+#include <ivm/relation.h>
+
+
+/**
+ * This class models the plan of how an update to a relation is joined with the
+ * other relations of the query, compiled once from the schemas into integer
+ * positions, so that processing an update never looks at attribute names.
+ *
+ * For each other relation, the plan gives the position in the update tuple of
+ * each attribute of the relation's key, except for the one attribute missing
+ * from the updated relation, which is left as an empty slot to be filled with
+ * each candidate value. Without that slot, the key is made of the attributes
+ * the relation shares with the updated one, on which it is probed through an
+ * index for the candidate values.
+ */
+class UpdatePlan {
+public:
+  /**
+   * Constructors
+   * ============ */
+
+  // Default constructor.
+  UpdatePlan() : rel_num(-1) {}
+
+  // The constructor compiles the plan for updates to a given relation.
+  UpdatePlan(const std::vector<Relation> &rels, int rel_num_);
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Fill the keys of the other relations with the values of an update tuple.
+  void fill_keys(const Tuple &t, std::vector<Tuple> &keys) const;
+
+  // Fill the key of a relation on the attributes it shares with the update.
+  void fill_shared_key(const Tuple &t, int i, Tuple &key) const;
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  // Get the position of the missing attribute in a relation's key.
+  int get_missing_slot(int i) const;
+
+  // Get the attributes a relation shares with the updated one.
+  const Schema &get_shared_attrs(int i) const;
+
+
+private:
+  // The updated relation.
+  int rel_num;
+
+  /**
+   * For each relation, the position in the update tuple of the value of each
+   * attribute of its key, or -1 for the missing attribute.
+   */
+  std::vector<std::vector<int> > key_positions;
+
+  // For each relation, the position of the missing attribute in its key.
+  std::vector<int> missing_slots;
+
+  // For each relation, the attributes it shares with the updated relation.
+  std::vector<Schema> shared_attrs;
+};
+
+#endif
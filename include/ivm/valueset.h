@@ -0,0 +1,75 @@
+#ifndef _VALUESET_H
+#define _VALUESET_H
+
+#include <ivm/tuple.h>
+
+#include <functional>
+
+
+/**
+ * This class models a set of attribute values. The members are kept in a
+ * contiguous array, so iterating over them is a linear scan, and the position
+ * of each member in the array is looked up either in a hash map or, when the
+ * values are dense dictionary IDs, directly in an array indexed by value.
+ *
+ * Each member is reference-counted: it is inserted once per occurrence, and it
+ * leaves the set when all of its occurrences have been erased.
+ */
+class ValueSet {
+public:
+  typedef std::pmr::vector<Value>::const_iterator const_iterator;
+
+
+  /**
+   * Constructor
+   * =========== */
+
+  /**
+   * The constructor initialises an empty set, which is direct-indexed if its
+   * values are known to be dense IDs, and allocates from the given resource.
+   */
+  ValueSet(bool dense_ = false, 
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+
+  /**
+   * Operations
+   * ========== */
+
+  // Add an occurrence of a value, adding the value if it is not in the set.
+  void insert(Value v);
+
+  // Remove an occurrence of a value, removing the value if it was the last.
+  void erase(Value v);
+
+
+  /**
+   * Accessors
+   * ========= */
+
+  // Return true if the value is in the set.
+  bool contains(Value v) const;
+
+  // Get the number of values in the set.
+  std::size_t size() const;
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+
+private:
+  // Whether the values are dense IDs, used as indexes into positions.
+  bool dense;
+
+  // The values in the set, in no particular order, and their occurrences.
+  std::pmr::vector<Value> members;
+  std::pmr::vector<int> counts;
+
+  // For dense sets, the position of each value in members, or -1 if absent.
+  std::pmr::vector<int> positions;
+
+  // For other sets, the position of each value in members.
+  FlatHashMap<Value, int, std::hash<Value> > position_map;
+};
+
+#endif
@@ -3,13 +3,16 @@
 
 #include <ivm/relation.h>
 
-#include <unordered_set>
-
 
 /**
- * This class models a view used for IVM with materialised views. It is
- * basically a relation which also stores for each attribute the set of values
- * that appear in the relation.
+ * This class models a view used for IVM with materialised views. It is a
+ * relation holding, for each tuple over the attributes of one relation, the
+ * count of the join of that tuple with all the other relations.
+ *
+ * A view maintained lazily also keeps a log of the updates to the relations it
+ * is computed from which it does not reflect yet. The updates to each relation
+ * are coalesced into a delta relation as they are logged, so the log holds the
+ * net change of each relation since the view was last brought up to date.
  */
 class View : public Relation {
 public:
@@ -17,35 +20,59 @@ public:
    * Constructor
    * =========== */
 
-  // The constructor initialises the relation and the sets of values.
-  View(const Schema &schema_);
+  // The constructor initialises the relation, allocated from a given resource.
+  View(const Schema &schema_, 
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
 
   /**
    * Operations
    * ========== */
 
-  // Add the values of a tuple to the sets of values.
-  void add_values(const Tuple &t);
-
   // Update a tuple.
-  void update_tuple(const Tuple &t, int multiplicity);
+  void update_tuple(const Tuple &t, LL multiplicity);
+
+  // Start keeping a log of updates to relations with the given schemas.
+  void add_update_log(const std::vector<Schema> &rel_schemas);
+
+  // Register an index on the given attributes of a relation's logged updates.
+  int add_pending_index(int rel_num, const Schema &key_attrs);
+
+  // Log an update to a relation, to be applied to the view later.
+  void log_update(int rel_num, const Tuple &t, LL multiplicity);
+
+  // Empty the log, once the view reflects the updates in it.
+  void clear_pending_updates();
 
 
   /**
    * Accessors
    * ========= */
 
-  // Get the set of values for a given attribute.
-  std::unordered_set<LL> get_existing_values(int attr_index) const;
+  // Return true if the log holds updates not reflected in the view.
+  bool has_pending_updates() const;
+
+  // Get the net change of a relation not reflected in the view.
+  const Relation &get_pending_updates(int rel_num) const;
+
+  // Get the logged updates to a relation matching a key of its index.
+  const SecondaryIndex::Bucket *lookup_pending(int rel_num, 
+      const Tuple &key) const;
 
 
 private:
+  // The updates to each relation logged since the log was last emptied.
+  std::vector<Relation> pending;
+
   /**
-   * For each attribute, store a set of the values for that attribute currently
-   * found in the relation.
+   * The attributes of the index registered on each delta relation, if any, and
+   * its number.
    */
-  std::vector<std::unordered_set<LL> > existing_values;
+  std::vector<Schema> pending_index_attrs;
+  std::vector<int> pending_index_nums;
+
+  // Whether any update was logged since the log was last emptied.
+  bool has_pending;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -17,7 +17,7 @@ public:
 	 * =========== */
 
 	// The constructor initialises a view processor for a query of order n.
-  ViewProcessor(int n_);
+  ViewProcessor(int n_, const Options &options_ = Options());
 
 
   /**
@@ -27,19 +27,45 @@ public:
   // Given an update to a relation, use materialised views to get the new count.
   LL update_and_count(int rel_num, const Tuple &t, int multiplicity);
 
+  // Given a batch of updates to a relation, maintain the views once.
+  LL update_and_count_batch(int rel_num, const UpdateBatch &batch);
+
 
 protected:
 	// Store a vector of views, one per relation.
   std::vector<View> views;
 
+  /**
+   * For each relation r and each other relation k, the number of the index of
+   * k on the attributes it shares with r.
+   */
+  std::vector<std::vector<int> > shared_indexes;
+
+  // The tuples of each relation matching the current update, if any.
+  std::vector<const SecondaryIndex::Bucket *> matches;
+
+  // The candidate values, and their multiplicities, of a logged update.
+  std::vector<std::pair<Value, LL> > fold_candidates;
+
 
   /**
    * Operations
    * ========== */
 
   // Maintain the views after updating a relation.
-  void update_views(int rel_num, const Tuple &t, int multiplicity, 
-  		bool new_tuple);
+  void update_views(int rel_num, const Tuple &t, int multiplicity);
+
+  // Look up the tuples of each other relation matching an update tuple.
+  void find_matches(int rel_num, const Tuple &t);
+
+  // Get the relation with the fewest matches to take a view's values from.
+  int get_candidate_rel(int rel_num, int view_num) const;
+
+  // Bring a lazily maintained view up to date with its logged updates.
+  void fold_view(int view_num);
+
+  // Apply to a view the change produced by one logged update.
+  void fold_update(int view_num, int rel_num, const Tuple &t, LL multiplicity);
 };
 
 #endif
\ No newline at end of file
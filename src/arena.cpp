@@ -0,0 +1,186 @@
+#include <ivm/arena.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#include <sys/mman.h>
+
+
+// The size of a huge page, to which huge page chunks are rounded up.
+const std::size_t HUGE_PAGE_SIZE = 1 << 21;
+
+// The size of a regular page, to which other mappings are rounded up.
+const std::size_t PAGE_SIZE = 1 << 12;
+
+
+/**
+ * Map a region of anonymous memory, whose size is a multiple of the page size.
+ * With huge pages enabled, first try an explicit huge page mapping, then fall
+ * back to regular pages with a hint to use transparent huge pages.
+ */
+static void *map_pages(std::size_t size, bool huge_pages) {
+  void *data = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+  if (huge_pages) {
+    data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (data == MAP_FAILED) {
+    data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages) {
+      madvise(data, size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  return data;
+}
+
+
+/**
+ * Constructor
+ * =========== */
+
+// Initialise an empty arena, which maps its first chunk on first use.
+Arena::Arena(bool huge_pages_, std::size_t chunk_size_) {
+  huge_pages = huge_pages_;
+  chunk_size = chunk_size_;
+  current = 0;
+  pos = nullptr;
+  limit = nullptr;
+}
+
+
+// Return all chunks to the operating system.
+Arena::~Arena() {
+  for (const auto &chunk : chunks) {
+    munmap(chunk.data, chunk.size);
+  }
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Rewind the arena to the start of its first chunk. Every allocation made so far
+ * becomes invalid, and the chunks are reused by the following allocations.
+ */
+void Arena::reset() {
+  current = 0;
+  if (chunks.empty()) {
+    pos = limit = nullptr;
+  } else {
+    pos = chunks[0].data;
+    limit = pos + chunks[0].size;
+  }
+}
+
+
+/**
+ * Allocate memory by bumping the position in the current chunk. If the request
+ * does not fit, move on to the next chunk kept from before the last reset that
+ * is large enough, or map a new chunk, at least twice as big as the last one.
+ */
+void *Arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+  std::uintptr_t aligned = ((std::uintptr_t)pos + alignment - 1) &
+      ~(std::uintptr_t)(alignment - 1);
+
+  while ((char *)aligned + bytes > limit || !pos) {
+    if (pos && current + 1 < chunks.size()) {
+      current++;
+    } else {
+      std::size_t size = chunks.empty() ? chunk_size :
+          2 * chunks.back().size;
+      while (size < bytes + alignment) {
+        size *= 2;
+      }
+      chunks.push_back(map_chunk(size));
+      current = chunks.size() - 1;
+    }
+    pos = chunks[current].data;
+    limit = pos + chunks[current].size;
+    aligned = ((std::uintptr_t)pos + alignment - 1) &
+        ~(std::uintptr_t)(alignment - 1);
+  }
+
+  pos = (char *)aligned + bytes;
+  return (void *)aligned;
+}
+
+
+// Two arenas are only interchangeable if they are the same arena.
+bool Arena::do_is_equal(const std::pmr::memory_resource &other) const
+    noexcept {
+  return this == &other;
+}
+
+
+// Map a new chunk, rounded up to a whole number of huge pages if they are used.
+Arena::Chunk Arena::map_chunk(std::size_t size) {
+  if (huge_pages) {
+    size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  }
+
+  return Chunk{(char *)map_pages(size, huge_pages), size};
+}
+
+
+/**
+ * Constructor
+ * =========== */
+
+// Initialise a resource which maps pages on each allocation.
+PageResource::PageResource(bool huge_pages_) {
+  huge_pages = huge_pages_;
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Map the pages holding an allocation. Mappings are aligned to the page size,
+ * which covers any alignment asked of a memory resource in the system.
+ */
+void *PageResource::do_allocate(std::size_t bytes, std::size_t) {
+  std::size_t size = mapping_size(bytes);
+
+  return map_pages(size, huge_pages && size >= HUGE_PAGE_SIZE);
+}
+
+
+// Unmap the pages holding an allocation, returning them to the system.
+void PageResource::do_deallocate(void *p, std::size_t bytes, std::size_t) {
+  munmap(p, mapping_size(bytes));
+}
+
+
+// Two page resources are interchangeable, since each mapping stands alone.
+bool PageResource::do_is_equal(const std::pmr::memory_resource &other) const
+    noexcept {
+  return dynamic_cast<const PageResource *>(&other) != nullptr;
+}
+
+
+/**
+ * Round an allocation up to whole pages. With huge pages enabled, allocations
+ * of at least a huge page are rounded up to whole huge pages, and smaller ones
+ * use regular pages, so they do not waste most of a huge page.
+ */
+std::size_t PageResource::mapping_size(std::size_t bytes) const {
+  std::size_t page = huge_pages && bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE :
+      PAGE_SIZE;
+
+  return std::max((bytes + page - 1) / page * page, page);
+}
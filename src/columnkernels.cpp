@@ -0,0 +1,337 @@
+#include <ivm/columnkernels.h>
+
+#include <algorithm>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define IVM_HAS_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+
+#ifdef IVM_HAS_AVX2_KERNELS
+
+/**
+ * Sum the multiplicities four at a time in a 256-bit register, using two
+ * independent accumulators to hide the latency of the additions.
+ */
+__attribute__((target("avx2")))
+static LL sum_avx2(const LL *mults, std::size_t size) {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    acc0 = _mm256_add_epi64(acc0, 
+        _mm256_loadu_si256((const __m256i *)(mults + i)));
+    acc1 = _mm256_add_epi64(acc1, 
+        _mm256_loadu_si256((const __m256i *)(mults + i + 4)));
+  }
+  acc0 = _mm256_add_epi64(acc0, acc1);
+
+  LL lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, acc0);
+  LL total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  for (; i < size; ++i) {
+    total += mults[i];
+  }
+
+  return total;
+}
+
+
+/**
+ * Transpose the columns four at a time. Four values of each of four columns
+ * are loaded, the 4x4 block is transposed in registers with unpacks and lane
+ * permutes, and each of its rows is stored with a single write into the
+ * tuple it belongs to. A remaining pair of columns is interleaved the same
+ * way, two values per row, and the columns and rows left over are copied one
+ * value at a time.
+ */
+__attribute__((target("avx2")))
+static void transpose_avx2(const Value *const *columns, int count, 
+    std::size_t size, Tuple *rows) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const Value *c0 = columns[i];
+    const Value *c1 = columns[i + 1];
+    const Value *c2 = columns[i + 2];
+    const Value *c3 = columns[i + 3];
+    std::size_t j = 0;
+#ifdef IVM_DENSE_IDS
+    for (; j + 4 <= size; j += 4) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(c0 + j));
+      __m128i b = _mm_loadu_si128((const __m128i *)(c1 + j));
+      __m128i c = _mm_loadu_si128((const __m128i *)(c2 + j));
+      __m128i d = _mm_loadu_si128((const __m128i *)(c3 + j));
+      __m128i ab_lo = _mm_unpacklo_epi32(a, b);
+      __m128i ab_hi = _mm_unpackhi_epi32(a, b);
+      __m128i cd_lo = _mm_unpacklo_epi32(c, d);
+      __m128i cd_hi = _mm_unpackhi_epi32(c, d);
+      _mm_storeu_si128((__m128i *)(rows[j].begin() + i), 
+          _mm_unpacklo_epi64(ab_lo, cd_lo));
+      _mm_storeu_si128((__m128i *)(rows[j + 1].begin() + i), 
+          _mm_unpackhi_epi64(ab_lo, cd_lo));
+      _mm_storeu_si128((__m128i *)(rows[j + 2].begin() + i), 
+          _mm_unpacklo_epi64(ab_hi, cd_hi));
+      _mm_storeu_si128((__m128i *)(rows[j + 3].begin() + i), 
+          _mm_unpackhi_epi64(ab_hi, cd_hi));
+    }
+#else
+    for (; j + 4 <= size; j += 4) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(c0 + j));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(c1 + j));
+      __m256i c = _mm256_loadu_si256((const __m256i *)(c2 + j));
+      __m256i d = _mm256_loadu_si256((const __m256i *)(c3 + j));
+      // Rows 0 and 2 in ab_lo and cd_lo, rows 1 and 3 in ab_hi and cd_hi.
+      __m256i ab_lo = _mm256_unpacklo_epi64(a, b);
+      __m256i ab_hi = _mm256_unpackhi_epi64(a, b);
+      __m256i cd_lo = _mm256_unpacklo_epi64(c, d);
+      __m256i cd_hi = _mm256_unpackhi_epi64(c, d);
+      _mm256_storeu_si256((__m256i *)(rows[j].begin() + i), 
+          _mm256_permute2x128_si256(ab_lo, cd_lo, 0x20));
+      _mm256_storeu_si256((__m256i *)(rows[j + 1].begin() + i), 
+          _mm256_permute2x128_si256(ab_hi, cd_hi, 0x20));
+      _mm256_storeu_si256((__m256i *)(rows[j + 2].begin() + i), 
+          _mm256_permute2x128_si256(ab_lo, cd_lo, 0x31));
+      _mm256_storeu_si256((__m256i *)(rows[j + 3].begin() + i), 
+          _mm256_permute2x128_si256(ab_hi, cd_hi, 0x31));
+    }
+#endif
+    for (; j < size; ++j) {
+      Value *row = rows[j].begin() + i;
+      row[0] = c0[j];
+      row[1] = c1[j];
+      row[2] = c2[j];
+      row[3] = c3[j];
+    }
+  }
+  for (; i + 2 <= count; i += 2) {
+    const Value *c0 = columns[i];
+    const Value *c1 = columns[i + 1];
+    std::size_t j = 0;
+#ifdef IVM_DENSE_IDS
+    for (; j + 4 <= size; j += 4) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(c0 + j));
+      __m128i b = _mm_loadu_si128((const __m128i *)(c1 + j));
+      __m128i lo = _mm_unpacklo_epi32(a, b);
+      __m128i hi = _mm_unpackhi_epi32(a, b);
+      _mm_storel_epi64((__m128i *)(rows[j].begin() + i), lo);
+      _mm_storel_epi64((__m128i *)(rows[j + 1].begin() + i), 
+          _mm_unpackhi_epi64(lo, lo));
+      _mm_storel_epi64((__m128i *)(rows[j + 2].begin() + i), hi);
+      _mm_storel_epi64((__m128i *)(rows[j + 3].begin() + i), 
+          _mm_unpackhi_epi64(hi, hi));
+    }
+#else
+    for (; j + 4 <= size; j += 4) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(c0 + j));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(c1 + j));
+      // Rows 0 and 2 in lo, rows 1 and 3 in hi.
+      __m256i lo = _mm256_unpacklo_epi64(a, b);
+      __m256i hi = _mm256_unpackhi_epi64(a, b);
+      _mm_storeu_si128((__m128i *)(rows[j].begin() + i), 
+          _mm256_castsi256_si128(lo));
+      _mm_storeu_si128((__m128i *)(rows[j + 1].begin() + i), 
+          _mm256_castsi256_si128(hi));
+      _mm_storeu_si128((__m128i *)(rows[j + 2].begin() + i), 
+          _mm256_extracti128_si256(lo, 1));
+      _mm_storeu_si128((__m128i *)(rows[j + 3].begin() + i), 
+          _mm256_extracti128_si256(hi, 1));
+    }
+#endif
+    for (; j < size; ++j) {
+      Value *row = rows[j].begin() + i;
+      row[0] = c0[j];
+      row[1] = c1[j];
+    }
+  }
+  for (; i < count; ++i) {
+    const Value *column = columns[i];
+    for (std::size_t j = 0; j < size; ++j) {
+      rows[j][i] = column[j];
+    }
+  }
+}
+
+
+/**
+ * Count the values of a sorted block smaller than v, comparing them with v
+ * several at a time. The count stops at the first lanes holding larger values,
+ * since all the values after them are larger too.
+ */
+__attribute__((target("avx2")))
+static std::size_t count_smaller_avx2(const Value *values, std::size_t size,
+    Value v) {
+  std::size_t count = 0;
+#ifdef IVM_DENSE_IDS
+  // Flip the sign bits, so the signed comparison orders unsigned IDs.
+  const __m256i flip = _mm256_set1_epi32((int)0x80000000);
+  const __m256i target = _mm256_xor_si256(_mm256_set1_epi32(v), flip);
+  for (; count + 8 <= size; count += 8) {
+    __m256i block = _mm256_xor_si256(
+        _mm256_loadu_si256((const __m256i *)(values + count)), flip);
+    int smaller = _mm256_movemask_ps(_mm256_castsi256_ps(
+        _mm256_cmpgt_epi32(target, block)));
+    if (smaller != 0xFF) {
+      return count + __builtin_popcount(smaller);
+    }
+  }
+#else
+  const __m256i target = _mm256_set1_epi64x(v);
+  for (; count + 4 <= size; count += 4) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(values + count));
+    int smaller = _mm256_movemask_pd(_mm256_castsi256_pd(
+        _mm256_cmpgt_epi64(target, block)));
+    if (smaller != 0xF) {
+      return count + __builtin_popcount(smaller);
+    }
+  }
+#endif
+  while (count < size && values[count] < v) {
+    count++;
+  }
+
+  return count;
+}
+
+#endif
+
+
+// The size of the blocks searched linearly at the end of a galloping search.
+const std::size_t SEEK_BLOCK_SIZE = 16;
+
+
+/**
+ * Find the first position from a given one at which a sorted column holds a
+ * value of at least v. The search gallops over exponentially growing steps to
+ * bound the range, then narrows it down with a binary search, and scans the
+ * last block linearly, so seeking close by is cheap and seeking far is
+ * logarithmic.
+ */
+static std::size_t seek(const Value *values, std::size_t from, 
+    std::size_t size, Value v) {
+  std::size_t lo = from;
+  std::size_t step = 1;
+  while (lo + step < size && values[lo + step] < v) {
+    lo += step;
+    step <<= 1;
+  }
+  std::size_t hi = std::min(lo + step + 1, size);
+
+  while (hi - lo > SEEK_BLOCK_SIZE) {
+    std::size_t mid = lo + (hi - lo) / 2;
+    if (values[mid] < v) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+#ifdef IVM_HAS_AVX2_KERNELS
+  if (ColumnKernels::has_avx2()) {
+    return lo + count_smaller_avx2(values + lo, hi - lo, v);
+  }
+#endif
+
+  while (lo < hi && values[lo] < v) {
+    lo++;
+  }
+  return lo;
+}
+
+
+// Return the sum of an array of multiplicities.
+LL ColumnKernels::sum(const LL *mults, std::size_t size) {
+#ifdef IVM_HAS_AVX2_KERNELS
+  if (has_avx2()) {
+    return sum_avx2(mults, size);
+  }
+#endif
+
+  LL total = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    total += mults[i];
+  }
+
+  return total;
+}
+
+
+/**
+ * Copy the first size values of each of count columns into the rows of a
+ * block of tuples. The scalar version fills the block one column at a time,
+ * so that each column is read sequentially.
+ */
+void ColumnKernels::transpose(const Value *const *columns, int count, 
+    std::size_t size, Tuple *rows) {
+#ifdef IVM_HAS_AVX2_KERNELS
+  if (has_avx2()) {
+    transpose_avx2(columns, count, size, rows);
+    return;
+  }
+#endif
+
+  for (int i = 0; i < count; ++i) {
+    const Value *column = columns[i];
+    for (std::size_t j = 0; j < size; ++j) {
+      rows[j][i] = column[j];
+    }
+  }
+}
+
+
+/**
+ * Intersect sorted columns by going through the smallest one, and seeking each
+ * of its values in the others. When a column does not have a value, the next
+ * value it has is sought in the smallest column in turn, so runs of values
+ * missing from any column are skipped over rather than visited one at a time.
+ */
+LL ColumnKernels::intersect_sum(std::vector<SortedColumn> &columns) {
+  std::sort(columns.begin(), columns.end(), 
+      [](const SortedColumn &a, const SortedColumn &b) {
+    return a.size < b.size;
+  });
+
+  std::vector<std::size_t> positions(columns.size(), 0);
+  const SortedColumn &first = columns[0];
+  LL total = 0;
+  std::size_t i = 0;
+  while (i < first.size) {
+    Value v = first.values[i];
+    LL product = first.mults[i];
+
+    for (int k = 1; k < columns.size(); ++k) {
+      const SortedColumn &column = columns[k];
+      std::size_t &pos = positions[k];
+      pos = seek(column.values, pos, column.size, v);
+      if (pos == column.size) {
+        return total;
+      }
+      if (column.values[pos] != v) {
+        v = column.values[pos];
+        product = 0;
+        break;
+      }
+      product *= column.mults[pos];
+    }
+
+    if (product) {
+      total += product;
+      i++;
+    } else {
+      i = seek(first.values, i + 1, first.size, v);
+    }
+  }
+
+  return total;
+}
+
+
+// Return true if the AVX2 versions of the kernels are used.
+bool ColumnKernels::has_avx2() {
+#ifdef IVM_HAS_AVX2_KERNELS
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return false;
+#endif
+}
@@ -1,3 +1,4 @@
+#include <ivm/columnkernels.h>
 #include <ivm/deltaprocessor.h>
 #include <ivm/helperfunctions.h>
 
@@ -6,9 +7,20 @@
  * Constructor
  * =========== */
 
-// The constructor initialises a delta processor for a query of order n.
-DeltaProcessor::DeltaProcessor(int n_) : IVMProcessor(n_) {
+/**
+ * The constructor initialises a delta processor for a query of order n. Each
+ * relation gets an index on the attributes it shares with the previous one, on
+ * which it is joined with the delta of an update to that relation.
+ */
+DeltaProcessor::DeltaProcessor(int n_, const Options &options_) : 
+    IVMProcessor(n_, options_) {
   current_count = 0;
+
+  for (int i = 0; i < n; ++i) {
+    int next_rel_num = (i + 1) % n;
+    next_indexes.push_back(rels[next_rel_num].add_index(
+        plans[i].get_shared_attrs(next_rel_num)));
+  }
 }
 
 
@@ -26,64 +38,184 @@ LL DeltaProcessor::update_and_count(int rel_num, const Tuple &t,
   // Update the relation.
   update_rel(rel_num, t, multiplicity);
 
-  // Construct the delta relation, which contains just the update tuple.
-  Relation delta_rel(rels[rel_num].get_schema());
-  delta_rel.update_tuple(t, multiplicity);
+  if (options.probe == INTERSECT_PROBE) {
+    current_count += multiplicity * intersect_count(rel_num, t);
+    return current_count;
+  }
 
   /**
-   * Join the delta relation with another one to get all values that need to be
-   * checked for the attribute missing from the initial delta relation.
+   * Look up the tuples of the next relation matching the update tuple, to get
+   * all values that need to be checked for the attribute missing from it.
    */
+  const UpdatePlan &plan = plans[rel_num];
   int next_rel_num = (rel_num + 1) % n;
-  delta_rel = delta_rel.join(rels[next_rel_num]);
+  Tuple next_key(n - 2);
+  plan.fill_shared_key(t, next_rel_num, next_key);
+  const SecondaryIndex::Bucket *matches = 
+      rels[next_rel_num].get_index(next_indexes[rel_num]).lookup(next_key);
 
   /** 
-   * If the join between the two is empty, then the update has no effect on the
-   * total count, so stop now.
+   * If there are no matching tuples, then the update has no effect on the total
+   * count, so stop now.
    */
-  if (delta_rel.empty()) {
+  if (!matches) {
     return current_count;
   }
 
-  // Get the attribute that is missing in the updated relation.
-  std::string missing_attr = rel_num == 0 ? 
-      "A" + std::to_string(n) : "A" + std::to_string(rel_num);
   /**
-   * Generate keys used to search each relation for the multiplicity that would
+   * Fill the keys used to search each relation for the multiplicity that would
    * correspond in a join to the updated tuple. For each relation other than the
-   * updated one, there is a key consisting of a tuple with values taken from
-   * the update tuple in the case of attributes shared by the updated relation
-   * and the key's relation, along with an empty slot for the other attribute
-   * that is not present in the updated relation, and its index in the tuple.
+   * updated one, the key has values taken from the update tuple in the case of
+   * attributes shared by the updated relation and the key's relation, along
+   * with an empty slot for the attribute not present in the updated relation.
    */
-  std::vector<std::pair<Tuple, int> > keys = HelperFunctions::generate_keys(
-      rels, t, rel_num, missing_attr);
-  // Get the entries in the join of the two relations.
-  std::unordered_map<Tuple, LL, container_hash<Tuple> > entries = 
-      delta_rel.get_entries();
-  // Get the position in the relation's schema of the attribute not in t.
-  int missing_idx = delta_rel.get_schema_map()[missing_attr];
-  for (auto e : entries) {
-    // Get the value for the attribute not in t, and the tuple count.
-    LL missing_val = e.first[missing_idx];
-    LL delta_count = e.second;
+  plan.fill_keys(t, keys);
 
+  /**
+   * Get the count difference for a value of the attribute not in t, given the
+   * count of the tuple in the join of the two relations, and the keys to fill.
+   */
+  auto probe = [&](std::vector<Tuple> &keys, Value missing_val, 
+      LL delta_count) {
     // Go through each other relation than the two already considered.
     for (int i = 0; i < n; ++i) {
       if (i == rel_num || i == next_rel_num) {
         continue;
       }
       // Fill the empty slot in the key.
-      keys[i].first[keys[i].second] = missing_val;
+      keys[i][plan.get_missing_slot(i)] = missing_val;
       // Get the count for the constructed tuple.
-      delta_count *= rels[i].get_multiplicity(keys[i].first);
+      delta_count *= rels[i].get_multiplicity(keys[i]);
       // If the count becomes 0, then stop looking through the other relations.
       if (!delta_count) {
         break;
       }
     }
-    current_count += delta_count;
+    return delta_count;
+  };
+
+  /**
+   * If the update fans out to many values, split them between the threads. Each
+   * chunk of values is probed with its own keys, and its differences are summed
+   * separately, then added up at the end.
+   */
+  if (pool.size() > 1 && matches->size() >= options.parallel_threshold) {
+    std::vector<std::pair<Value, LL> > fanout;
+    fanout.reserve(matches->size());
+    for (const auto &e : *matches) {
+      fanout.emplace_back(e.first[0], e.second);
+    }
+
+    std::vector<LL> chunk_counts(pool.get_num_chunks(), 0);
+    pool.parallel_for_chunks(fanout.size(), 
+        [&](int chunk, std::size_t begin, std::size_t end) {
+      std::vector<Tuple> chunk_keys = keys;
+      for (std::size_t k = begin; k < end; ++k) {
+        chunk_counts[chunk] += probe(chunk_keys, fanout[k].first, 
+            multiplicity * fanout[k].second);
+      }
+    });
+    for (LL chunk_count : chunk_counts) {
+      current_count += chunk_count;
+    }
+
+    return current_count;
+  }
+
+  for (const auto &e : *matches) {
+    /**
+     * Get the value for the attribute not in t, which is all that is left of
+     * the matching tuple besides the key, and the tuple count.
+     */
+    current_count += probe(keys, e.first[0], multiplicity * e.second);
+  }
+
+  return current_count;
+}
+
+
+/**
+ * Count the join of an update tuple with all the other relations. Each of them
+ * gives, through its sorted index on the attributes it shares with the updated
+ * relation, the sorted list of values of the missing attribute found with the
+ * update tuple, so the join is the intersection of these lists, where each
+ * value counts for the product of its multiplicities in the lists.
+ */
+LL DeltaProcessor::intersect_count(int rel_num, const Tuple &t) {
+  if (sorted_indexes.empty()) {
+    sorted_indexes.assign(n, std::vector<int>(n, -1));
+    for (int r = 0; r < n; ++r) {
+      for (int k = 0; k < n; ++k) {
+        if (k != r) {
+          sorted_indexes[r][k] = rels[k].add_sorted_index(
+              plans[r].get_shared_attrs(k));
+        }
+      }
+    }
+  }
+
+  Tuple shared_key(n - 2);
+  std::vector<ColumnKernels::SortedColumn> columns;
+  columns.reserve(n - 1);
+  for (int k = 0; k < n; ++k) {
+    if (k == rel_num) {
+      continue;
+    }
+    plans[rel_num].fill_shared_key(t, k, shared_key);
+    const SortedIndex::Bucket *matches = rels[k].get_sorted_index(
+        sorted_indexes[rel_num][k]).lookup(shared_key);
+    // If a relation has no matching tuples, then neither has the join.
+    if (!matches) {
+      return 0;
+    }
+    columns.push_back({matches->values.data(), matches->mults.data(), 
+        matches->values.size()});
+  }
+
+  return ColumnKernels::intersect_sum(columns);
+}
+
+
+/**
+ * Given a batch of updates to one of the relations, merge them into a delta
+ * relation, and use delta processing to compute the difference produced in the
+ * query result by the whole batch at once.
+ *
+ * The difference is the join of the delta relation with all other relations,
+ * which is computed as a chain of joins following the cycle from the updated
+ * relation. Each join is aggregated by the attributes of the relations joined
+ * after it, so that the delta tuples leading to the same lookups in the rest
+ * of the chain share them.
+ */
+LL DeltaProcessor::update_and_count_batch(int rel_num, 
+    const UpdateBatch &batch) {
+  // Free the temporary relations of the previous update.
+  scratch_arena.reset();
+
+  Relation delta_rel = coalesce_batch(rel_num, batch, &scratch_arena);
+  if (delta_rel.empty()) {
+    return current_count;
+  }
+
+  // Update the relation.
+  delta_rel.for_each_entry([&](const Tuple &t, LL mult) {
+    update_rel(rel_num, t, mult);
+  });
+
+  // Get the attributes of the relations after each one in the cycle.
+  std::vector<Schema> group_schemas(n);
+  for (int k = n - 2; k > 0; --k) {
+    group_schemas[k] = HelperFunctions::schema_union(group_schemas[k + 1], 
+        rels[(rel_num + k + 1) % n].get_schema());
+  }
+
+  Relation rel_join = delta_rel.join_group_by(rels[(rel_num + 1) % n], 
+      group_schemas[1], &scratch_arena, &pool);
+  for (int k = 2; k < n - 1; ++k) {
+    rel_join = rel_join.join_group_by(rels[(rel_num + k) % n], 
+        group_schemas[k], &scratch_arena, &pool);
   }
+  current_count += rel_join.join_count(rels[(rel_num + n - 1) % n], &pool);
 
   return current_count;
 }
\ No newline at end of file
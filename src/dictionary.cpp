@@ -0,0 +1,42 @@
+#include <ivm/dictionary.h>
+
+#include <cassert>
+#include <limits>
+#include <map>
+
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * Give each distinct attribute in the schemas its own dictionary, and record
+ * for each position in each schema which dictionary it uses.
+ */
+Dictionary::Dictionary(const std::vector<Schema> &schemas) {
+  std::map<std::string, int> attr_map;
+
+  for (const auto &schema : schemas) {
+    std::vector<int> ids;
+    for (const auto &attr : schema) {
+      auto it = attr_map.insert(std::make_pair(attr, attr_map.size())).first;
+      ids.push_back(it->second);
+    }
+    attr_ids.push_back(ids);
+  }
+  dicts.resize(attr_map.size());
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+// Get the ID of a raw value, assigning the next free ID to unseen values.
+Value Dictionary::encode(int rel_num, int attr_index, LL raw_val) {
+  FlatHashMap<LL, Value, std::hash<LL> > &dict = 
+      dicts[attr_ids[rel_num][attr_index]];
+  assert(dict.size() < std::numeric_limits<Value>::max());
+
+  return dict.try_emplace(raw_val, dict.size()).first->second;
+}
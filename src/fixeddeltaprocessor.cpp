@@ -0,0 +1,134 @@
+#include <ivm/fixeddeltaprocessor.h>
+
+#include <cassert>
+
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * The constructor initialises a delta processor for a query of order N, and
+ * picks the specialised update function of each relation.
+ */
+template <int N>
+FixedDeltaProcessor<N>::FixedDeltaProcessor(const Options &options_) :
+    DeltaProcessor(N, options_) {
+  update_functions = get_update_functions(std::make_index_sequence<N>());
+
+  assert(FixedSchema<N>::matches(plans));
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Given an update to one of the relations, use delta processing to compute the
+ * difference produced in the query result, then add it to the current count,
+ * and return the new count. With several threads, or when the matching values
+ * are found by intersection, the generic update is used.
+ */
+template <int N>
+LL FixedDeltaProcessor<N>::update_and_count(int rel_num, const Tuple &t,
+    int multiplicity) {
+  if (pool.size() > 1 || options.probe == INTERSECT_PROBE) {
+    return DeltaProcessor::update_and_count(rel_num, t, multiplicity);
+  }
+
+  return (this->*update_functions[rel_num])(t, multiplicity);
+}
+
+
+/**
+ * Given an update to relation R, compute the difference produced in the query
+ * result in the same way as the generic delta processor, but with the plan of
+ * the update known at compile time.
+ */
+template <int N>
+template <int R>
+LL FixedDeltaProcessor<N>::update_and_count_rel(const Tuple &t,
+    int multiplicity) {
+  constexpr int NEXT = (R + 1) % N;
+  static constexpr std::array<std::array<int, N - 1>, N> KEY_POSITIONS =
+      FixedSchema<N>::key_positions(R);
+  static constexpr std::array<int, N> MISSING_SLOTS =
+      FixedSchema<N>::missing_slots(R);
+  static constexpr std::array<std::array<int, N - 2>, N>
+      SHARED_KEY_POSITIONS = FixedSchema<N>::shared_key_positions(R);
+
+  // Update the relation.
+  update_rel(R, t, multiplicity);
+
+  // Look up the tuples of the next relation matching the update tuple.
+  std::array<Value, N - 2> next_key;
+  for (int i = 0; i < N - 2; ++i) {
+    next_key[i] = t[SHARED_KEY_POSITIONS[NEXT][i]];
+  }
+  const SecondaryIndex::Bucket *matches =
+      rels[NEXT].get_index(next_indexes[R]).lookup(next_key);
+  if (!matches) {
+    return current_count;
+  }
+
+  // Fill the keys of the other relations with the values of the update tuple.
+  std::array<std::array<Value, N - 1>, N> keys{};
+  for (int i = 0; i < N; ++i) {
+    if (i == R || i == NEXT) {
+      continue;
+    }
+    for (int j = 0; j < N - 1; ++j) {
+      if (KEY_POSITIONS[i][j] >= 0) {
+        keys[i][j] = t[KEY_POSITIONS[i][j]];
+      }
+    }
+  }
+
+  for (const auto &e : *matches) {
+    LL delta_count = multiplicity * e.second;
+
+    // Go through each other relation than the two already considered.
+    for (int i = 0; i < N; ++i) {
+      if (i == R || i == NEXT) {
+        continue;
+      }
+      keys[i][MISSING_SLOTS[i]] = e.first[0];
+      delta_count *= rels[i].get_multiplicity(keys[i]);
+      if (!delta_count) {
+        break;
+      }
+    }
+    current_count += delta_count;
+  }
+
+  return current_count;
+}
+
+
+// Get the specialised update function of each relation.
+template <int N>
+template <std::size_t... R>
+std::array<typename FixedDeltaProcessor<N>::UpdateFunction, N>
+    FixedDeltaProcessor<N>::get_update_functions(std::index_sequence<R...>) {
+  return {{&FixedDeltaProcessor::update_and_count_rel<R>...}};
+}
+
+
+// Instantiate the processor for each query order supported by the build.
+template class FixedDeltaProcessor<3>;
+#if IVM_MAX_QUERY_ORDER >= 4
+template class FixedDeltaProcessor<4>;
+#endif
+#if IVM_MAX_QUERY_ORDER >= 5
+template class FixedDeltaProcessor<5>;
+#endif
+#if IVM_MAX_QUERY_ORDER >= 6
+template class FixedDeltaProcessor<6>;
+#endif
+#if IVM_MAX_QUERY_ORDER >= 7
+template class FixedDeltaProcessor<7>;
+#endif
+#if IVM_MAX_QUERY_ORDER >= 8
+template class FixedDeltaProcessor<8>;
+#endif
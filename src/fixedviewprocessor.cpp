@@ -0,0 +1,152 @@
+#include <ivm/fixedviewprocessor.h>
+
+#include <cassert>
+
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * The constructor initialises a view processor for a query of order N, and
+ * picks the specialised view maintenance function of each relation.
+ */
+template <int N>
+FixedViewProcessor<N>::FixedViewProcessor(const Options &options_) :
+    ViewProcessor(N, options_) {
+  update_functions = get_update_functions(std::make_index_sequence<N>());
+
+  assert(FixedSchema<N>::matches(plans));
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Given an update to a relation, update the current count using the view that
+ * corresponds to the updated relation, then maintain all other views, and
+ * return the updated count. With several threads, the views are maintained by
+ * the generic function, as it splits large sets of candidate values between
+ * them, and so are views maintained lazily.
+ */
+template <int N>
+LL FixedViewProcessor<N>::update_and_count(int rel_num, const Tuple &t,
+    int multiplicity) {
+  if (pool.size() > 1 || options.lazy_views) {
+    return ViewProcessor::update_and_count(rel_num, t, multiplicity);
+  }
+
+  // Update the count using the relation's view.
+  current_count += multiplicity * views[rel_num].get_multiplicity(t);
+  // Update the relation.
+  update_rel(rel_num, t, multiplicity);
+
+  (this->*update_functions[rel_num])(t, multiplicity);
+
+  return current_count;
+}
+
+
+/**
+ * Maintain the views after an update to relation R in the same way as the
+ * generic view processor, but with the plan of the update known at compile
+ * time.
+ */
+template <int N>
+template <int R>
+void FixedViewProcessor<N>::update_views_rel(const Tuple &t,
+    int multiplicity) {
+  static constexpr std::array<std::array<int, N - 1>, N> KEY_POSITIONS =
+      FixedSchema<N>::key_positions(R);
+  static constexpr std::array<int, N> MISSING_SLOTS =
+      FixedSchema<N>::missing_slots(R);
+  static constexpr std::array<std::array<int, N - 2>, N>
+      SHARED_KEY_POSITIONS = FixedSchema<N>::shared_key_positions(R);
+
+  /**
+   * Fill the keys of the other relations with the values of the update tuple,
+   * and look up the tuples of the other relations matching it. The keys of
+   * the views are kept as tuples, as they are inserted into the views.
+   */
+  std::array<std::array<Value, N - 1>, N> keys{};
+  std::array<Tuple, N> view_keys;
+  for (int i = 0; i < N; ++i) {
+    if (i == R) {
+      continue;
+    }
+    for (int j = 0; j < N - 1; ++j) {
+      if (KEY_POSITIONS[i][j] >= 0) {
+        keys[i][j] = t[KEY_POSITIONS[i][j]];
+      }
+    }
+    view_keys[i] = Tuple(keys[i]);
+
+    std::array<Value, N - 2> shared_key;
+    for (int j = 0; j < N - 2; ++j) {
+      shared_key[j] = t[SHARED_KEY_POSITIONS[i][j]];
+    }
+    matches[i] = rels[i].get_index(shared_indexes[R][i]).lookup(shared_key);
+  }
+
+  for (int i = 0; i < N; ++i) {
+    if (i == R) {
+      continue;
+    }
+
+    int candidate_rel_num = get_candidate_rel(R, i);
+    if (candidate_rel_num < 0) {
+      continue;
+    }
+
+    // Go through the candidate values for the missing attribute.
+    for (const auto &e : *matches[candidate_rel_num]) {
+      Value v = e.first[0];
+      LL delta_count = multiplicity * e.second;
+
+      for (int j = 0; j < N; ++j) {
+        if (j == i || j == R || j == candidate_rel_num) {
+          continue;
+        }
+        keys[j][MISSING_SLOTS[j]] = v;
+        delta_count *= rels[j].get_multiplicity(keys[j]);
+        if (!delta_count) {
+          break;
+        }
+      }
+      if (delta_count) {
+        view_keys[i][MISSING_SLOTS[i]] = v;
+        views[i].update_tuple(view_keys[i], delta_count);
+      }
+    }
+  }
+}
+
+
+// Get the specialised view maintenance function of each relation.
+template <int N>
+template <std::size_t... R>
+std::array<typename FixedViewProcessor<N>::UpdateFunction, N>
+    FixedViewProcessor<N>::get_update_functions(std::index_sequence<R...>) {
+  return {{&FixedViewProcessor::update_views_rel<R>...}};
+}
+
+
+// Instantiate the processor for each query order supported by the build.
+template class FixedViewProcessor<3>;
+#if IVM_MAX_QUERY_ORDER >= 4
+template class FixedViewProcessor<4>;
+#endif
+#if IVM_MAX_QUERY_ORDER >= 5
+template class FixedViewProcessor<5>;
+#endif
+#if IVM_MAX_QUERY_ORDER >= 6
+template class FixedViewProcessor<6>;
+#endif
+#if IVM_MAX_QUERY_ORDER >= 7
+template class FixedViewProcessor<7>;
+#endif
+#if IVM_MAX_QUERY_ORDER >= 8
+template class FixedViewProcessor<8>;
+#endif
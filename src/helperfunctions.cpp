@@ -6,52 +6,6 @@
 #include <iostream>
 
 
-/**
- * For a given set of relations corresponding to a query of order n, and a given
- * tuple from a certain relation (denoted by its number and the excluded 
- * attribute), generate a vector of keys for the other relations.
- *
- * For a relation S, other than the updated relation R, a key is a tuple where 
- * the values of the attributes shared by R and S have been filled with the
- * values from vals, the updated tuple in R. The last value in the key is empty,
- * and its position in the tuple is stored along with the tuple.
- */
-std::vector<std::pair<Tuple, int> > HelperFunctions::generate_keys(
-    const std::vector<Relation> &rels, const Tuple &vals,
-    int excluded_rel_num, const std::string &excluded_attr) {
-  // Initialise the key vector.
-  std::vector<std::pair<Tuple, int> > keys(rels.size());
-  // Get the schema map of the excluded relation.
-  std::map<std::string, int> sm = rels[excluded_rel_num].get_schema_map();
-  Tuple key(rels.size() - 1);
-  // Go through all relations other than the excluded one.
-  for (int i = 0; i < rels.size(); ++i) {
-    if (i == excluded_rel_num) {
-      continue;
-    }
-
-    int idx;
-    Schema schema = rels[i].get_schema();
-    // Generate the key.
-    for (int j = 0; j < schema.size(); ++j) {
-      /**
-       * Put a "blank" slot for the excluded attribute, and the tuple's values
-       * for the other attributes.
-       */
-      if (schema[j] == excluded_attr) {
-        idx = j;
-        key[j] = 0;
-      } else {
-        key[j] = vals[sm[schema[j]]];
-      }
-    }
-    keys[i] = std::make_pair(key, idx);
-  }
-  
-  return keys;
-}
-
-
 /**
  * Return the next partition configuration, given a specific configuration. For
  * example, for the configuration LLL, the next one would be HLL, followed by
@@ -118,15 +72,43 @@ Schema HelperFunctions::schema_union(const Schema &a, const Schema &b) {
 }
 
 
+// Return true if a string is a positive decimal number.
+static bool is_positive_number(const char *str) {
+  if (!*str) {
+    return false;
+  }
+  for (int i = 0; str[i] != 0; ++i) {
+    if (!isdigit(str[i])) {
+      return false;
+    }
+  }
+
+  return atoi(str) > 0;
+}
+
+
+// Return true if a string is a decimal number strictly between 0 and 1.
+static bool is_fraction(const char *str) {
+  char *end;
+  double value = strtod(str, &end);
+
+  return *str && !*end && 0 < value && value < 1;
+}
+
+
 /**
  * Validate the command line arguments passed to the system. Return true if the
  * arguments are valid, or false otherwise.
  */
 bool HelperFunctions::validate_arguments(int argc, char **argv) {
-  if (argc != 6) {
+  if (argc < 6) {
     std::cerr << "Usage: " << argv[0] << " N " <<
-        "/relative/path/to/query-file (naive|delta|view|skew) " << 
-        "/relative/path/to/output-file max-number-of-updates\n";
+        "/relative/path/to/query-file (naive|delta|view|higher|skew) " << 
+        "/relative/path/to/output-file max-number-of-updates " <<
+        "[--huge-pages] [--dict] [--columnar] [--lazy] " <<
+        "[--engine=(binary|leapfrog)] [--probe=(hash|intersect)] " <<
+        "[--threads=K] [--parallel-threshold=K] [--batch=K] " <<
+        "[--epsilon=E]\n";
     return false;
   }
 
@@ -144,6 +126,10 @@ bool HelperFunctions::validate_arguments(int argc, char **argv) {
     std::cerr << "N must be at least 3!\n";
     return false;
   }
+  if (atoi(argv[1]) > MAX_QUERY_ORDER) {
+    std::cerr << "N must be at most " << MAX_QUERY_ORDER << "!\n";
+    return false;
+  }
 
   std::ifstream f(argv[2]);
   if (!f.good()) {
@@ -153,9 +139,10 @@ bool HelperFunctions::validate_arguments(int argc, char **argv) {
   }
 
   if (strcmp(argv[3], "naive") && strcmp(argv[3], "delta") && 
-      strcmp(argv[3], "view") && strcmp(argv[3], "skew")) {
+      strcmp(argv[3], "view") && strcmp(argv[3], "higher") &&
+      strcmp(argv[3], "skew")) {
     std::cerr << "Invalid join type! Choose between: naive, delta, view, " << 
-        "skew.\n";
+        "higher, skew.\n";
     return false;
   }
 
@@ -174,5 +161,80 @@ bool HelperFunctions::validate_arguments(int argc, char **argv) {
     }
   }
 
+  for (int i = 6; i < argc; ++i) {
+    if (!strncmp(argv[i], "--engine=", 9)) {
+      if (strcmp(argv[i] + 9, "binary") && strcmp(argv[i] + 9, "leapfrog")) {
+        std::cerr << "Invalid join engine! Choose between: binary, " <<
+            "leapfrog.\n";
+        return false;
+      }
+    } else if (!strncmp(argv[i], "--probe=", 8)) {
+      if (strcmp(argv[i] + 8, "hash") && strcmp(argv[i] + 8, "intersect")) {
+        std::cerr << "Invalid probe strategy! Choose between: hash, " <<
+            "intersect.\n";
+        return false;
+      }
+    } else if (!strncmp(argv[i], "--threads=", 10)) {
+      if (!is_positive_number(argv[i] + 10)) {
+        std::cerr << "Invalid number of threads! Use a positive number.\n";
+        return false;
+      }
+    } else if (!strncmp(argv[i], "--parallel-threshold=", 21)) {
+      if (!is_positive_number(argv[i] + 21)) {
+        std::cerr << "Invalid parallel threshold! Use a positive number.\n";
+        return false;
+      }
+    } else if (!strncmp(argv[i], "--batch=", 8)) {
+      if (!is_positive_number(argv[i] + 8)) {
+        std::cerr << "Invalid batch size! Use a positive number.\n";
+        return false;
+      }
+    } else if (!strncmp(argv[i], "--epsilon=", 10)) {
+      if (!is_fraction(argv[i] + 10)) {
+        std::cerr << "Invalid epsilon! Use a number between 0 and 1.\n";
+        return false;
+      }
+    } else if (strcmp(argv[i], "--huge-pages") && strcmp(argv[i], "--dict") &&
+        strcmp(argv[i], "--columnar") && strcmp(argv[i], "--lazy")) {
+      std::cerr << "Unknown option " << argv[i] << "!\n";
+      return false;
+    }
+  }
+
   return true;
+}
+
+
+/**
+ * Get the optional settings given on the command line after the mandatory
+ * arguments, which are assumed to have been validated.
+ */
+Options HelperFunctions::parse_options(int argc, char **argv) {
+  Options options;
+
+  for (int i = 6; i < argc; ++i) {
+    if (!strcmp(argv[i], "--huge-pages")) {
+      options.huge_pages = true;
+    } else if (!strcmp(argv[i], "--dict")) {
+      options.dense_ids = true;
+    } else if (!strcmp(argv[i], "--columnar")) {
+      options.columnar = true;
+    } else if (!strcmp(argv[i], "--lazy")) {
+      options.lazy_views = true;
+    } else if (!strcmp(argv[i], "--engine=leapfrog")) {
+      options.engine = LEAPFROG_JOIN;
+    } else if (!strcmp(argv[i], "--probe=intersect")) {
+      options.probe = INTERSECT_PROBE;
+    } else if (!strncmp(argv[i], "--threads=", 10)) {
+      options.threads = atoi(argv[i] + 10);
+    } else if (!strncmp(argv[i], "--parallel-threshold=", 21)) {
+      options.parallel_threshold = atoi(argv[i] + 21);
+    } else if (!strncmp(argv[i], "--batch=", 8)) {
+      options.batch_size = atoi(argv[i] + 8);
+    } else if (!strncmp(argv[i], "--epsilon=", 10)) {
+      options.epsilon = atof(argv[i] + 10);
+    }
+  }
+
+  return options;
 }
\ No newline at end of file
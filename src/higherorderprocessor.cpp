@@ -0,0 +1,230 @@
+#include <ivm/helperfunctions.h>
+#include <ivm/higherorderprocessor.h>
+
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * Initialise a higher-order processor with n relations, the first-order view of
+ * each relation, and the second-order view of each pair of relations. Each
+ * relation gets an index on the attributes it shares with each other one, and
+ * each second-order view an index on the attributes of each relation of its
+ * pair, through which the views are maintained.
+ */
+HigherOrderProcessor::HigherOrderProcessor(int n_, const Options &options_) :
+    IVMProcessor(n_, options_) {
+  current_count = 0;
+
+  // Get all the attributes of the query.
+  Schema full_schema;
+  for (const auto &rel : rels) {
+    full_schema = HelperFunctions::schema_union(full_schema, rel.get_schema());
+  }
+
+  views.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    views.push_back(Relation(rels[i].get_schema(), &storage_pool));
+  }
+
+  full_positions.resize(n);
+  full_missing_slots.resize(n);
+  for (int j = 0; j < n; ++j) {
+    const std::map<std::string, int> &sm = rels[j].get_schema_map();
+    for (int p = 0; p < full_schema.size(); ++p) {
+      auto it = sm.find(full_schema[p]);
+      if (it == sm.end()) {
+        full_missing_slots[j] = p;
+        full_positions[j].push_back(-1);
+      } else {
+        full_positions[j].push_back(it->second);
+      }
+    }
+  }
+
+  // Get the positions in an update tuple of j of the given attributes.
+  auto get_positions = [&](int j, const Schema &attrs) {
+    std::vector<int> positions;
+    for (const auto &attr : attrs) {
+      positions.push_back(rels[j].get_schema_map().at(attr));
+    }
+    return positions;
+  };
+
+  rel_indexes.assign(n, std::vector<int>(n, -1));
+  for (int j = 0; j < n; ++j) {
+    for (int k = 0; k < n; ++k) {
+      if (k != j) {
+        rel_indexes[j][k] = rels[k].add_index(plans[j].get_shared_attrs(k));
+      }
+    }
+  }
+
+  /**
+   * For a query of order 3, the join of the relations other than a pair is
+   * the third relation, so there is nothing to materialise.
+   */
+  std::vector<std::vector<int> > pair_nums(n, std::vector<int>(n, -1));
+  if (n > 3) {
+    pair_views.reserve(n * (n - 1) / 2);
+    for (int r = 0; r < n; ++r) {
+      for (int s = r + 1; s < n; ++s) {
+        pair_nums[r][s] = pair_nums[s][r] = pairs.size();
+        pairs.emplace_back(r, s);
+        pair_views.push_back(Relation(full_schema, &storage_pool));
+      }
+    }
+  }
+
+  pair_view_of.assign(n, std::vector<Relation *>(n, nullptr));
+  pair_view_indexes.assign(n, std::vector<int>(n, -1));
+  pair_view_key_positions.assign(n, std::vector<std::vector<int> >(n));
+  for (int r = 0; r < n; ++r) {
+    for (int j = 0; j < n; ++j) {
+      if (j == r) {
+        continue;
+      }
+      Relation *pair_view = n > 3 ?
+          &pair_views[pair_nums[r][j]] : &rels[3 - r - j];
+      Schema key_attrs = HelperFunctions::schema_intersection(
+          pair_view->get_schema(), rels[j].get_schema());
+      pair_view_of[r][j] = pair_view;
+      pair_view_indexes[r][j] = pair_view->add_index(key_attrs);
+      pair_view_key_positions[r][j] = get_positions(j, key_attrs);
+    }
+  }
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Given an update to a relation, update the current count using the relation's
+ * first-order view, then maintain the first-order views of the other relations
+ * using the second-order views, and the second-order views containing the
+ * updated relation using the other relations, and return the updated count.
+ *
+ * None of the views used to compute a delta contains the updated relation, so
+ * the views can be maintained in any order.
+ */
+LL HigherOrderProcessor::update_and_count(int rel_num, const Tuple &t,
+    int multiplicity) {
+  // Update the count using the relation's view.
+  current_count += multiplicity * views[rel_num].get_multiplicity(t);
+  // Update the relation.
+  update_rel(rel_num, t, multiplicity);
+
+  const UpdatePlan &plan = plans[rel_num];
+  plan.fill_keys(t, keys);
+
+  /**
+   * The change to the view of relation r is the join of the update tuple with
+   * the second-order view of r and the updated relation, so each of its tuples
+   * matching the update tuple adds to one tuple of the view.
+   */
+  for (int r = 0; r < n; ++r) {
+    if (r == rel_num) {
+      continue;
+    }
+    const SecondaryIndex::Bucket *matches = pair_view_of[r][rel_num]->get_index(
+        pair_view_indexes[r][rel_num]).lookup(
+            project(t, pair_view_key_positions[r][rel_num]));
+    if (!matches) {
+      continue;
+    }
+
+    int slot = plan.get_missing_slot(r);
+    for (const auto &e : *matches) {
+      keys[r][slot] = e.first[0];
+      views[r].update_tuple(keys[r], multiplicity * e.second);
+    }
+  }
+
+  for (int p = 0; p < pairs.size(); ++p) {
+    if (pairs[p].first != rel_num && pairs[p].second != rel_num) {
+      update_pair_view(p, rel_num, t, multiplicity);
+    }
+  }
+
+  return current_count;
+}
+
+
+/**
+ * Maintain a second-order view after an update to one of the relations it is
+ * the join of. The change is the join of the update tuple with the other
+ * relations of the view. The values of the attribute missing from the update
+ * tuple are taken from the relation with the fewest matching tuples, then the
+ * remaining relations are probed for each of them, as in delta processing.
+ */
+void HigherOrderProcessor::update_pair_view(int pair_num, int rel_num,
+    const Tuple &t, int multiplicity) {
+  int r = pairs[pair_num].first;
+  int s = pairs[pair_num].second;
+  const UpdatePlan &plan = plans[rel_num];
+
+  // Find the relation with the fewest tuples matching the update tuple.
+  Tuple shared_key(n - 2);
+  const SecondaryIndex::Bucket *candidates = nullptr;
+  int candidate_rel_num = -1;
+  for (int k = 0; k < n; ++k) {
+    if (k == r || k == s || k == rel_num) {
+      continue;
+    }
+    plan.fill_shared_key(t, k, shared_key);
+    const SecondaryIndex::Bucket *matches = rels[k].get_index(
+        rel_indexes[rel_num][k]).lookup(shared_key);
+    // If a relation has no matching tuples, then the view does not change.
+    if (!matches) {
+      return;
+    }
+    if (!candidates || matches->size() < candidates->size()) {
+      candidates = matches;
+      candidate_rel_num = k;
+    }
+  }
+
+  Tuple full_tuple(n);
+  for (int p = 0; p < n; ++p) {
+    if (full_positions[rel_num][p] >= 0) {
+      full_tuple[p] = t[full_positions[rel_num][p]];
+    }
+  }
+
+  for (const auto &e : *candidates) {
+    Value v = e.first[0];
+    LL delta_count = multiplicity * e.second;
+
+    // Go through each other relation of the view.
+    for (int k = 0; k < n; ++k) {
+      if (k == r || k == s || k == rel_num || k == candidate_rel_num) {
+        continue;
+      }
+      keys[k][plan.get_missing_slot(k)] = v;
+      delta_count *= rels[k].get_multiplicity(keys[k]);
+      if (!delta_count) {
+        break;
+      }
+    }
+
+    if (delta_count) {
+      full_tuple[full_missing_slots[rel_num]] = v;
+      pair_views[pair_num].update_tuple(full_tuple, delta_count);
+    }
+  }
+}
+
+
+// Get a key made of the values of a tuple at the given positions.
+Tuple HigherOrderProcessor::project(const Tuple &t,
+    const std::vector<int> &positions) {
+  Tuple key(positions.size());
+  for (int i = 0; i < positions.size(); ++i) {
+    key[i] = t[positions[i]];
+  }
+
+  return key;
+}
@@ -9,12 +9,16 @@
 
 /**
  * Given a query order n, construct n relations with schemas as specified in the
- * exam problem statement.
+ * exam problem statement, and compile the plan of updates to each of them.
  */
-IVMProcessor::IVMProcessor(int n_) {
+IVMProcessor::IVMProcessor(int n_, const Options &options_) : 
+    options(options_), storage_pages(options_.huge_pages), 
+    storage_pool(&storage_pages), scratch_arena(options_.huge_pages),
+    pool(options_.threads) {
   n = n_;
 
   Schema schema(n - 1);
+  rels.reserve(n);
   for (int i = 0; i < n; ++i) {
     for (int j = 1; j < n; ++j) {
       // Compute the attribute index.
@@ -22,8 +26,13 @@ IVMProcessor::IVMProcessor(int n_) {
       schema[j - 1] = "A" + std::to_string(idx);
     }
     // Create a new relation.
-    rels.push_back(Relation(schema));
+    rels.push_back(Relation(schema, &storage_pool, options.columnar));
   }
+
+  for (int i = 0; i < n; ++i) {
+    plans.push_back(UpdatePlan(rels, i));
+  }
+  keys.assign(n, Tuple(n - 1));
 }
 
 
@@ -32,13 +41,56 @@ IVMProcessor::IVMProcessor(int n_) {
  * ========== */
 
 // Update the given relation by adding the given multiplicity for the tuple t.
-void IVMProcessor::update_rel(int rel_num, const Tuple &t, int multiplicity) {
+void IVMProcessor::update_rel(int rel_num, const Tuple &t, LL multiplicity) {
   assert(0 <= rel_num && rel_num < n);
 
   rels[rel_num].update_tuple(t, multiplicity);
 }
 
 
+/**
+ * Merge a batch of updates to a relation into a delta relation, allocated from
+ * the given memory resource. Updates to the same tuple are added up, so the
+ * delta relation holds each tuple once, and tuples whose updates cancel out
+ * are left out.
+ */
+Relation IVMProcessor::coalesce_batch(int rel_num, const UpdateBatch &batch,
+    std::pmr::memory_resource *resource) {
+  Relation delta_rel(rels[rel_num].get_schema(), resource);
+  for (const auto &update : batch) {
+    delta_rel.update_tuple(update.first, update.second);
+  }
+
+  return delta_rel;
+}
+
+
 // Given an update to a relation, compute and return the new count.
 LL IVMProcessor::update_and_count(int rel_num, const Tuple &t, 
-    int multiplicity) {}
\ No newline at end of file
+    int multiplicity) {}
+
+
+/**
+ * Given a non-empty batch of updates to a relation, compute and return the new
+ * count. By default, the updates are simply processed one after the other.
+ */
+LL IVMProcessor::update_and_count_batch(int rel_num, const UpdateBatch &batch) {
+  assert(!batch.empty());
+
+  LL result = 0;
+  for (const auto &update : batch) {
+    result = update_and_count(rel_num, update.first, update.second);
+  }
+
+  return result;
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+// Get the schema of a given relation.
+const Schema &IVMProcessor::get_schema(int rel_num) const {
+  return rels[rel_num].get_schema();
+}
\ No newline at end of file
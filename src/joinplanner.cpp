@@ -0,0 +1,149 @@
+#include <ivm/joinplanner.h>
+
+#include <algorithm>
+#include <limits>
+#include <set>
+
+
+// Relations smaller than this are considered to be of this size for drift.
+const std::size_t REPLAN_MIN_SIZE = 64;
+
+// The factor by which a relation has to grow or shrink to trigger a re-plan.
+const std::size_t REPLAN_FACTOR = 2;
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Pick the order in which to join the relations. For each subset of relations,
+ * find the cheapest way to join them as a chain, as the cheapest chain for the
+ * subset without one of them, followed by a join with that one. The cost of a
+ * chain is the number of tuples probing the indexes, plus the number of tuples
+ * in the intermediate results. The last join only counts its result, so its
+ * output costs nothing.
+ */
+const std::vector<int> &JoinPlanner::plan(const std::vector<Relation> &rels) {
+  int n = rels.size();
+  unsigned int full = (1u << n) - 1;
+
+  std::vector<double> sizes(full + 1);
+  std::vector<double> costs(full + 1, std::numeric_limits<double>::max());
+  std::vector<int> last(full + 1, -1);
+  for (unsigned int s = 1; s <= full; ++s) {
+    sizes[s] = estimate_size(rels, s);
+    if (__builtin_popcount(s) == 1) {
+      costs[s] = 0;
+    }
+  }
+
+  // Subsets are visited after all of their own subsets.
+  for (unsigned int s = 1; s <= full; ++s) {
+    if (__builtin_popcount(s) < 2) {
+      continue;
+    }
+    for (int r = 0; r < n; ++r) {
+      unsigned int prev = s & ~(1u << r);
+      if (prev == s) {
+        continue;
+      }
+      double cost = costs[prev] + sizes[prev] + (s == full ? 0 : sizes[s]);
+      if (cost < costs[s]) {
+        costs[s] = cost;
+        last[s] = r;
+      }
+    }
+  }
+
+  // Follow the choices back from the full set to build the order.
+  order.assign(n, 0);
+  unsigned int s = full;
+  for (int i = n - 1; i > 0; --i) {
+    order[i] = last[s];
+    s &= ~(1u << last[s]);
+  }
+  order[0] = __builtin_ctz(s);
+
+  planned_sizes.clear();
+  for (const auto &rel : rels) {
+    planned_sizes.push_back(rel.size());
+  }
+
+  return order;
+}
+
+
+/**
+ * Return true if there is no plan yet, or if any relation grew or shrank by
+ * more than the drift factor since the last plan.
+ */
+bool JoinPlanner::needs_replan(const std::vector<Relation> &rels) const {
+  if (order.empty()) {
+    return true;
+  }
+
+  for (int i = 0; i < rels.size(); ++i) {
+    std::size_t size = std::max(rels[i].size(), REPLAN_MIN_SIZE);
+    std::size_t planned_size = std::max(planned_sizes[i], REPLAN_MIN_SIZE);
+    if (size > REPLAN_FACTOR * planned_size ||
+        planned_size > REPLAN_FACTOR * size) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+/**
+ * Estimate the size of the join of a subset of the relations, given as a bit
+ * mask, aggregated by the attributes of the other relations. The size of the
+ * join is the product of the relations' sizes, divided, for each attribute, by
+ * the numbers of distinct values in all the relations containing it except the
+ * one with the fewest. The aggregation bounds it by the product of the numbers
+ * of distinct values of the attributes kept.
+ */
+double JoinPlanner::estimate_size(const std::vector<Relation> &rels,
+    unsigned int subset) const {
+  std::map<std::string, std::vector<double> > distinct_counts;
+  std::set<std::string> other_attrs;
+  double size = 1;
+
+  for (int r = 0; r < rels.size(); ++r) {
+    const Schema &schema = rels[r].get_schema();
+    if (!(subset & (1u << r))) {
+      other_attrs.insert(schema.begin(), schema.end());
+      continue;
+    }
+    size *= std::max(rels[r].size(), (std::size_t)1);
+    for (int i = 0; i < schema.size(); ++i) {
+      distinct_counts[schema[i]].push_back(
+          std::max(rels[r].get_distinct_count(i), (std::size_t)1));
+    }
+  }
+
+  double groups = 1;
+  for (auto &attr : distinct_counts) {
+    std::vector<double> &counts = attr.second;
+    std::sort(counts.begin(), counts.end());
+    for (int i = 1; i < counts.size(); ++i) {
+      size /= counts[i];
+    }
+    if (other_attrs.count(attr.first)) {
+      groups *= counts[0];
+    }
+  }
+
+  return other_attrs.empty() ? size : std::min(size, groups);
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+// Get the order picked by the last plan.
+const std::vector<int> &JoinPlanner::get_order() const {
+  return order;
+}
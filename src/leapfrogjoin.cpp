@@ -0,0 +1,102 @@
+#include <ivm/helperfunctions.h>
+#include <ivm/leapfrogjoin.h>
+
+#include <algorithm>
+#include <cassert>
+
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * Prepare the join of the given relations, by ordering all of their attributes
+ * and finding the relations which contain each of them.
+ */
+LeapfrogJoin::LeapfrogJoin(const std::vector<Relation> &rels) {
+  Schema attrs;
+  for (const auto &rel : rels) {
+    assert(rel.get_trie_index());
+    iters.push_back(rel.get_trie_index()->root());
+    attrs = HelperFunctions::schema_union(attrs, rel.get_schema());
+  }
+
+  participants.resize(attrs.size());
+  for (int i = 0; i < attrs.size(); ++i) {
+    for (int j = 0; j < rels.size(); ++j) {
+      if (rels[j].get_schema_map().count(attrs[i])) {
+        participants[i].push_back(j);
+      }
+    }
+  }
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+// Count the tuples in the join, as given by the sum of all multiplicities.
+LL LeapfrogJoin::count() {
+  return count_from(0);
+}
+
+
+/**
+ * Count the join tuples extending the values bound to the first attributes.
+ * The relations which contain the next attribute go down one level in their
+ * tries, and leapfrog over each other: the iterator with the smallest value
+ * seeks to the largest value, until they all agree on a value, which is then
+ * bound before moving on to the next attribute. Once all attributes are bound,
+ * every iterator points to a single tuple, and the join tuple's multiplicity
+ * is the product of theirs.
+ */
+LL LeapfrogJoin::count_from(int depth) {
+  if (depth == participants.size()) {
+    LL mult = 1;
+    for (const auto &it : iters) {
+      mult *= it.multiplicity();
+    }
+    return mult;
+  }
+
+  const std::vector<int> &rel_nums = participants[depth];
+  int k = rel_nums.size();
+  bool done = false;
+  for (int rel_num : rel_nums) {
+    iters[rel_num].open();
+    done |= iters[rel_num].at_end();
+  }
+
+  LL total_count = 0;
+  if (!done) {
+    // Sort the iterators by their current value.
+    int order[MAX_QUERY_ORDER];
+    std::copy(rel_nums.begin(), rel_nums.end(), order);
+    std::sort(order, order + k, [&](int a, int b) {
+      return iters[a].key() < iters[b].key();
+    });
+
+    Value max_key = iters[order[k - 1]].key();
+    for (int i = 0; ; i = (i + 1) % k) {
+      TrieIndex::Iterator &it = iters[order[i]];
+      // The smallest value is equal to the largest, so all values agree.
+      if (it.key() == max_key) {
+        total_count += count_from(depth + 1);
+        it.next();
+      } else {
+        it.seek(max_key);
+      }
+      if (it.at_end()) {
+        break;
+      }
+      max_key = it.key();
+    }
+  }
+
+  for (int rel_num : rel_nums) {
+    iters[rel_num].up();
+  }
+
+  return total_count;
+}
@@ -1,5 +1,9 @@
 #include <ivm/deltaprocessor.h>
+#include <ivm/dictionary.h>
+#include <ivm/fixeddeltaprocessor.h>
+#include <ivm/fixedviewprocessor.h>
 #include <ivm/helperfunctions.h>
+#include <ivm/higherorderprocessor.h>
 #include <ivm/naiveprocessor.h>
 #include <ivm/skewprocessor.h>
 #include <ivm/viewprocessor.h>
@@ -12,6 +16,22 @@
 typedef std::chrono::high_resolution_clock ClockT;
 
 
+/**
+ * Create a processor specialised for the given query order, which has already
+ * been checked to be supported, by going through the orders from N up to the
+ * largest one the build supports.
+ */
+template <template <int> class FixedProcessor, int N = 3>
+IVMProcessor *create_fixed_processor(int n, const Options &options) {
+  if constexpr (N < MAX_QUERY_ORDER) {
+    if (n != N) {
+      return create_fixed_processor<FixedProcessor, N + 1>(n, options);
+    }
+  }
+  return new FixedProcessor<N>(options);
+}
+
+
 int main(int argc, char **argv) {
   // Ensure the command line arguments are valid.
   bool valid_args = HelperFunctions::validate_arguments(argc, argv);
@@ -26,45 +46,88 @@ int main(int argc, char **argv) {
   std::string join_type = argv[3];
   std::ofstream output_file(argv[4]);
   int update_limit = atoi(argv[5]);
+  Options options = HelperFunctions::parse_options(argc, argv);
 
   // Initialise the required IVM processor.
   IVMProcessor *ivm_proc;
   if (join_type == "naive") {
-    ivm_proc = new NaiveProcessor(n);
+    ivm_proc = new NaiveProcessor(n, options);
   } else if (join_type == "delta") {
-    ivm_proc = new DeltaProcessor(n);
+    ivm_proc = create_fixed_processor<FixedDeltaProcessor>(n, options);
   } else if (join_type == "view") {
-    ivm_proc = new ViewProcessor(n);
+    ivm_proc = create_fixed_processor<FixedViewProcessor>(n, options);
+  } else if (join_type == "higher") {
+    ivm_proc = new HigherOrderProcessor(n, options);
   } else {
-    ivm_proc = new SkewProcessor(n);
+    ivm_proc = new SkewProcessor(n, options);
   }
 
+  // Set up the dictionaries used to encode the values, if needed.
+  std::vector<Schema> schemas;
+  for (int i = 0; i < n; ++i) {
+    schemas.push_back(ivm_proc->get_schema(i));
+  }
+  Dictionary dictionary(schemas);
+
   std::string input;
   int rel_num;
   int multiplicity;
   int update_count = 0;
 
+  // The updates collected for each relation in the current batch, if any.
+  std::vector<UpdateBatch> batches(n);
+  int batch_fill = 0;
+
   auto t1 = ClockT::now();
+
+  // Print a result, along with the time elapsed so far.
+  auto write_result = [&](LL result) {
+    auto t2 = ClockT::now();
+    double elapsed_time_so_far = (double)(std::chrono::duration_cast
+        <std::chrono::seconds>(t2 - t1).count());
+
+    output_file << result << "," << elapsed_time_so_far << "\n";
+  };
+
+  // Process the collected updates one relation at a time, and get the result.
+  auto process_batches = [&]() {
+    LL result = 0;
+    for (int i = 0; i < n; ++i) {
+      if (!batches[i].empty()) {
+        result = ivm_proc->update_and_count_batch(i, batches[i]);
+        batches[i].clear();
+      }
+    }
+    batch_fill = 0;
+
+    return result;
+  };
+
   // Read the lines and update the database.
   while (getline(query_file, input, ',') && 
       (update_count < update_limit || !update_limit)) {
     rel_num = stoi(input);
-    std::vector<LL> tuple;
+    Tuple tuple;
 
     for (int i = 0; i < n - 1; ++i) {
       getline(query_file, input, ',');
-      tuple.push_back(stoll(input));
+      LL val = stoll(input);
+      tuple.push_back(options.dense_ids ? 
+          dictionary.encode(rel_num - 1, i, val) : val);
     }
     getline(query_file, input);
     multiplicity = stoi(input);
     
-    LL result = ivm_proc->update_and_count(rel_num - 1, tuple, multiplicity);
-
-    auto t2 = ClockT::now();
-    double elapsed_time_so_far = (double)(std::chrono::duration_cast
-        <std::chrono::seconds>(t2 - t1).count());
-
-    output_file << result << "," << elapsed_time_so_far << "\n";
+    if (options.batch_size) {
+      // Collect the update, and process the batch once it is full.
+      batches[rel_num - 1].emplace_back(tuple, multiplicity);
+      if (++batch_fill == options.batch_size) {
+        write_result(process_batches());
+      }
+    } else {
+      write_result(ivm_proc->update_and_count(rel_num - 1, tuple, 
+          multiplicity));
+    }
 
     // Print some progress dots from time to time.
     if (!(update_count % 500)) {
@@ -72,6 +135,10 @@ int main(int argc, char **argv) {
     }
     update_count++;
   }
+  // Process the last, partial batch.
+  if (batch_fill) {
+    write_result(process_batches());
+  }
   std::cout << "\n";
   auto t2 = ClockT::now();
   double duration = (double)(std::chrono::duration_cast
@@ -1,3 +1,5 @@
+#include <ivm/helperfunctions.h>
+#include <ivm/leapfrogjoin.h>
 #include <ivm/naiveprocessor.h>
 
 
@@ -5,8 +7,22 @@
  * Constructor
  * =========== */
 
-// Construct the relations for the given query order n.
-NaiveProcessor::NaiveProcessor(int n_) : IVMProcessor(n_) {}
+/**
+ * Construct the relations for the given query order n. For the leapfrog
+ * triejoin, register a trie index on each of them. Otherwise, keep statistics
+ * on them, from which the order of the binary joins is planned on the first
+ * update.
+ */
+NaiveProcessor::NaiveProcessor(int n_, const Options &options_) : 
+    IVMProcessor(n_, options_) {
+  for (auto &rel : rels) {
+    if (options.engine == LEAPFROG_JOIN) {
+      rel.add_trie_index();
+    } else {
+      rel.add_statistics(options.dense_ids);
+    }
+  }
+}
 
 
 /**
@@ -19,12 +35,87 @@ LL NaiveProcessor::update_and_count(int rel_num, const Tuple &t,
   // Update the relation.
   update_rel(rel_num, t, multiplicity);
 
-  // Compute the entire join.
-  Relation rel_join = rels[0].join(rels[1]);
-  for (int i = 2; i < n; ++i) {
-    rel_join = rel_join.join(rels[i]);
+  return evaluate();
+}
+
+
+/**
+ * Given a batch of updates to a relation, apply all of them, then re-evaluate
+ * the query only once, and get the new count.
+ */
+LL NaiveProcessor::update_and_count_batch(int rel_num, 
+    const UpdateBatch &batch) {
+  for (const auto &update : batch) {
+    update_rel(rel_num, update.first, update.second);
+  }
+
+  return evaluate();
+}
+
+
+// Re-evaluate the query with the selected join engine, and get the count.
+LL NaiveProcessor::evaluate() {
+  if (options.engine == LEAPFROG_JOIN) {
+    return LeapfrogJoin(rels).count();
+  }
+
+  if (planner.needs_replan(rels)) {
+    plan_joins();
   }
 
-  // Count the total multiplicity and return it.
-  return rel_join.count();
+  // Free the intermediate join results of the previous update.
+  scratch_arena.reset();
+
+  /**
+   * Compute the join up to the last relation, aggregated by the attributes of
+   * the relations joined later, and keep the intermediate results in the
+   * arena. Then count the join with the last relation without building it.
+   */
+  const std::vector<int> &order = planner.get_order();
+  Relation rel_join = rels[order[0]].join_group_by(rels[order[1]], 
+      group_schemas[1], &scratch_arena, &pool);
+  for (int i = 2; i < n - 1; ++i) {
+    rel_join = rel_join.join_group_by(rels[order[i]], group_schemas[i], 
+        &scratch_arena, &pool);
+  }
+
+  return rel_join.join_count(rels[order[n - 1]], &pool);
+}
+
+
+/**
+ * Plan the order of the binary joins from the current statistics, then get the
+ * attributes each join is aggregated by, and register on each relation the
+ * index its join will probe, replacing those of the previous plan.
+ */
+void NaiveProcessor::plan_joins() {
+  const std::vector<int> &order = planner.plan(rels);
+
+  /**
+   * Each join in the chain only keeps the attributes of the relations joined
+   * after it, which are the ones the count still depends on.
+   */
+  group_schemas.assign(n, Schema());
+  for (int i = n - 2; i > 0; --i) {
+    group_schemas[i] = HelperFunctions::schema_union(group_schemas[i + 1], 
+        rels[order[i + 1]].get_schema());
+  }
+
+  for (auto &rel : rels) {
+    rel.clear_indexes();
+  }
+  Schema join_schema = rels[order[0]].get_schema();
+  for (int i = 1; i < n; ++i) {
+    Relation &rel = rels[order[i]];
+    const Schema &rel_schema = rel.get_schema();
+    Schema join_attr = HelperFunctions::schema_intersection(join_schema, 
+        rel_schema);
+    // The relation is probed directly if the join is on its whole schema.
+    if (join_attr != rel_schema) {
+      rel.add_index(join_attr);
+    }
+    join_schema = HelperFunctions::schema_intersection(
+        HelperFunctions::schema_union(join_schema, rel_schema), 
+        group_schemas[i]);
+  }
 }
\ No newline at end of file
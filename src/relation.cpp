@@ -1,9 +1,165 @@
+#include <ivm/columnkernels.h>
 #include <ivm/helperfunctions.h>
 #include <ivm/relation.h>
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
+#include <numeric>
+
+
+// The smallest relation whose joins are split between the threads of a pool.
+const std::size_t PARALLEL_JOIN_MIN_SIZE = 1 << 12;
+
+// The number of partitions per thread in a parallel join.
+const int PARTITIONS_PER_THREAD = 4;
+
+// The number of products of multiplicities added up at once in a join count.
+const std::size_t COUNT_BLOCK_SIZE = 64;
+
+// The tuples of a relation and their multiplicities, split into partitions.
+typedef std::vector<std::vector<std::pair<Tuple, LL> > > Partitions;
+
+
+/**
+ * Get, for each attribute in the schema of the result of joining a relation
+ * with another relation, R, where to look for its value in a pair of matching
+ * tuples: either in the tuple of the relation (0), or in the tuple of the
+ * values of R's non-join attributes (1), and at which position.
+ */
+static std::vector<std::pair<int, int> > get_join_attr_order(
+    const Schema &schema, const Schema &r_schema, 
+    const std::vector<int> &r_val_indices, const Schema &res_schema) {
+  std::vector<std::pair<int, int> > join_attr_order(res_schema.size());
+  for (int i = 0; i < res_schema.size(); ++i) {
+    bool found = false;
+    // Check for the attribute in the schema of the relation.
+    for (int j = 0; j < schema.size(); ++j) {
+      if (schema[j] == res_schema[i]) {
+        join_attr_order[i] = std::make_pair(0, j);
+        found = true;
+        break;
+      }
+    }
+    // Check for the attribute among R's non-join attributes.
+    if (!found) {
+      for (int j = 0; j < r_val_indices.size(); ++j) {
+        if (r_schema[r_val_indices[j]] == res_schema[i]) {
+          join_attr_order[i] = std::make_pair(1, j);
+          break;
+        }
+      }
+    }
+  }
+
+  return join_attr_order;
+}
+
+
+// Get the number of bits of the partition IDs for a pool of a given size.
+static int get_partition_bits(int num_threads) {
+  int bits = 1;
+  while ((1 << bits) < num_threads * PARTITIONS_PER_THREAD) {
+    bits++;
+  }
+
+  return bits;
+}
+
+
+/**
+ * Split the tuples of a relation into partitions, by the hash of their values
+ * at the given positions. The partition of a tuple is given by the top bits of
+ * its hash, multiplied by a large odd constant to mix them.
+ */
+static void partition_entries(const Relation &rel, 
+    const std::vector<int> &key_indices, int part_bits, Partitions &parts) {
+  parts.assign(1 << part_bits, std::vector<std::pair<Tuple, LL> >());
+  container_hash<Tuple> hash;
+  Tuple key(key_indices.size());
+
+  rel.for_each_entry([&](const Tuple &t, LL mult) {
+    for (int i = 0; i < key_indices.size(); ++i) {
+      key[i] = t[key_indices[i]];
+    }
+    std::uint64_t h = (std::uint64_t)hash(key) * 0x9e3779b97f4a7c15ULL;
+    parts[h >> (64 - part_bits)].emplace_back(t, mult);
+  });
+}
+
+
+/**
+ * Find the pairs of matching tuples of two relations, S and R, with a radix-
+ * partitioned hash join on a pool of threads. Both relations are partitioned
+ * on the hash of their join attributes, then each pair of partitions is joined
+ * by a separate task, which builds a hash index on R's partition and probes it
+ * with S's partition. If the join attributes make up R's whole schema, R's
+ * entries are probed directly instead, and only S is partitioned.
+ *
+ * For each match, the task handling partition p calls f(p, s_t, r_vals, mult),
+ * where r_vals holds the values of R's non-join attributes, and mult is the
+ * product of the two multiplicities.
+ */
+template <typename F>
+static void partitioned_join(const Relation &s, const Relation &r, 
+    const Schema &join_attr, ThreadPool &pool, int part_bits, F f) {
+  std::vector<int> s_key_indices;
+  std::vector<int> r_key_indices;
+  for (const auto &attr : join_attr) {
+    s_key_indices.push_back(s.get_schema_map().at(attr));
+    r_key_indices.push_back(r.get_schema_map().at(attr));
+  }
+  bool probe_entries = join_attr.size() == r.get_schema_size();
+
+  // Partition both relations at the same time.
+  Partitions s_parts;
+  Partitions r_parts;
+  pool.parallel_for(probe_entries ? 1 : 2, [&](int i) {
+    if (i) {
+      partition_entries(r, r_key_indices, part_bits, r_parts);
+    } else {
+      partition_entries(s, s_key_indices, part_bits, s_parts);
+    }
+  });
+
+  // Join each pair of partitions in a separate task.
+  pool.parallel_for(1 << part_bits, [&](int p) {
+    Tuple key(join_attr.size());
+
+    if (probe_entries) {
+      Tuple no_vals(0);
+      for (const auto &e : s_parts[p]) {
+        for (int i = 0; i < s_key_indices.size(); ++i) {
+          key[i] = e.first[s_key_indices[i]];
+        }
+        LL r_mult = r.get_multiplicity(key);
+        if (r_mult) {
+          f(p, e.first, no_vals, e.second * r_mult);
+        }
+      }
+      return;
+    }
+
+    SecondaryIndex index(r.get_schema(), join_attr, 
+        std::pmr::new_delete_resource());
+    for (const auto &e : r_parts[p]) {
+      index.update_tuple(e.first, e.second);
+    }
+    for (const auto &e : s_parts[p]) {
+      for (int i = 0; i < s_key_indices.size(); ++i) {
+        key[i] = e.first[s_key_indices[i]];
+      }
+      const SecondaryIndex::Bucket *vals = index.lookup(key);
+      if (!vals) {
+        continue;
+      }
+      for (const auto &v : *vals) {
+        f(p, e.first, v.first, e.second * v.second);
+      }
+    }
+  });
+}
 
 
 /**
@@ -14,12 +170,22 @@
  * Construct a new relation with the given schema. As per the instructions in
  * the exam, the schema must have at least two attributes, since n >= 3.
  */
-Relation::Relation(const Schema &schema_) {
+Relation::Relation(const Schema &schema_, std::pmr::memory_resource *resource,
+    bool columnar_) : entries(resource), mults(resource), row_index(resource),
+    trie(resource) {
   // Check the schema size is at least 2.
   assert(schema_.size() > 1);
 
   schema = schema_;
   schema_size = schema.size();
+  columnar = columnar_;
+  has_trie = false;
+  has_statistics = false;
+  if (columnar) {
+    for (int i = 0; i < schema_size; ++i) {
+      columns.emplace_back(resource);
+    }
+  }
 
   /**
    * Store the attributes in the schema in sorted order, to make it easier to
@@ -40,10 +206,14 @@ Relation::Relation(const Schema &schema_) {
 
 // Count the total number of tuples as given by the sum of all multiplicities.
 LL Relation::count() const {
+  if (columnar) {
+    return ColumnKernels::sum(mults.data(), mults.size());
+  }
+
   LL total_count = 0;
 
   // Go through all entries and add their multiplicities.
-  for (auto e : entries) {
+  for (const auto &e : entries) {
     total_count += e.second;
   }
 
@@ -51,185 +221,470 @@ LL Relation::count() const {
 }
 
 
+// Join this relation with another relation, R, and return the result.
+Relation Relation::join(const Relation &r, 
+    std::pmr::memory_resource *resource, ThreadPool *pool) {
+  return join_group_by(r, HelperFunctions::schema_union(schema, r.schema), 
+      resource, pool);
+}
+
+
 /**
- * Join this relation with another relation, R. The join will be performed by
- * creating an index on R on the join attributes using a multimap, and then 
- * going through the entries in this relation to look up the join attributes in
- * the index.
+ * Join this relation with another relation, R, keeping only the given (sorted)
+ * group-by attributes in the result. The multiplicities of join tuples which
+ * agree on these attributes are summed, so when only the count of a chain of
+ * joins is needed, each join can drop the attributes that later joins do not
+ * use, and its result stays bounded by the number of groups.
+ *
+ * The join will be performed by probing R's secondary index on the join
+ * attributes with the entries in this relation. If R has no such index
+ * registered, a temporary one is built first. If the join attributes make up
+ * R's whole schema, R's entries are probed directly instead.
  *
  * This join algorithm is made for relations stored in uniform representation,
  * so it also computes the multiplicities of the resulting tuples.
  *
- * Assuming both relations have size N, the creation of the hash index has
- * complexity O(N*logN), and the join also has complexity O(N*logN).
+ * Assuming this relation has size N, the join has expected complexity O(N)
+ * plus the size of the result when R's index is registered, as is the case for
+ * every join performed by the IVM processors. Otherwise, building the temporary
+ * index adds O(|R|).
+ *
+ * The result, and the temporary index if any, are allocated from the given
+ * memory resource, so that temporary join results can live in an arena.
  *
- * The overall join complexity is O(N*logN).
+ * Given a pool of several threads, a large enough join is instead performed as
+ * a radix-partitioned hash join, in which each task aggregates its matches in
+ * its own relation, and the relations are then merged into the result.
  */
-Relation Relation::join(const Relation &r) {
+Relation Relation::join_group_by(const Relation &r, const Schema &group_attrs,
+    std::pmr::memory_resource *resource, ThreadPool *pool) {
   // Get information about R.
-  Schema r_schema = r.get_schema();
-  std::unordered_map<Tuple, LL, container_hash<Tuple> > r_entries = 
-      r.get_entries();
+  const Schema &r_schema = r.schema;
 
-  // The join schema will be the union of the two schemas.
-  Schema res_schema = HelperFunctions::schema_union(schema, r_schema);
+  // The result schema will be made of the group-by attributes of both schemas.
+  Schema res_schema = HelperFunctions::schema_intersection(
+      HelperFunctions::schema_union(schema, r_schema), group_attrs);
   // The join attributes will be the intersection of the two schemas.
   Schema join_attr = HelperFunctions::schema_intersection(schema, r_schema);
-  // Initialise the resulting relation.
-  Relation res = Relation(res_schema);
+  // Initialise the resulting relation, stored the same way as this one.
+  Relation res = Relation(res_schema, resource, columnar);
 
-  /**
-   * Go through the attributes in R's schema and sort them into two vectors
-   * depending on whether they are part of the join attributes or not. 
-   *
-   * The former will become the key of the index on R, while the latter will 
-   * become the value (along with the tuple's multiplicity).
-   */
-  std::vector<int> r_key_indices;
-  std::vector<int> r_val_indices;
-  for (int i = 0, j = 0; i < r_schema.size(); ++i) {
-    // Put each attribute index in either of the two vectors.
-    if (r_schema[i] == join_attr[j]) {
-      r_key_indices.push_back(i);
-      j++;
-    } else {
-      r_val_indices.push_back(i);
+  // Get the positions in this relation's schema of the join attributes.
+  std::vector<int> key_indices(join_attr.size());
+  for (int i = 0; i < join_attr.size(); ++i) {
+    key_indices[i] = schema_map[join_attr[i]];
+  }
+  Tuple key(join_attr.size());
+  Tuple join_t(res_schema.size());
+
+  if (pool && pool->size() > 1 && size() >= PARALLEL_JOIN_MIN_SIZE) {
+    // Get the positions in R's schema of the non-join attributes.
+    std::vector<int> r_val_indices;
+    for (int i = 0; i < r_schema.size(); ++i) {
+      if (!std::binary_search(join_attr.begin(), join_attr.end(), 
+          r_schema[i])) {
+        r_val_indices.push_back(i);
+      }
     }
+    std::vector<std::pair<int, int> > join_attr_order = get_join_attr_order(
+        schema, r_schema, r_val_indices, res_schema);
+
+    int part_bits = get_partition_bits(pool->size());
+    std::vector<Relation> part_results;
+    for (int p = 0; p < (1 << part_bits); ++p) {
+      part_results.emplace_back(res_schema, std::pmr::new_delete_resource());
+    }
+    partitioned_join(*this, r, join_attr, *pool, part_bits, 
+        [&](int p, const Tuple &t, const Tuple &r_vals, LL mult) {
+      Tuple part_join_t(res_schema.size());
+      int j = 0;
+      for (const auto &o : join_attr_order) {
+        part_join_t[j++] = o.first ? r_vals[o.second] : t[o.second];
+      }
+      part_results[p].update_tuple(part_join_t, mult);
+    });
+
+    for (const auto &part_result : part_results) {
+      part_result.for_each_entry([&](const Tuple &t, LL mult) {
+        res.update_tuple(t, mult);
+      });
+    }
+
+    return res;
   }
 
   /**
-   * Get information on where to look for the value needed to construct result
-   * tuples. This will be used during the joining of the two relations, when
-   * iterating through the relation's tuples and checking R's tuples through the
-   * index.
-   *
-   * The values of the successfully joined tuples will be obtained either from 
-   * the current tuple in this relation, or the <key, value> pair in R's index.
-   * As such, a vector detailing the join attribute order will be created here,
-   * specifying for each attribute where to look for its value (in the current
-   * tuple of this relation or in the <key, value> pair of R's index), and at
-   * which index.
+   * If all of R's attributes are join attributes, each tuple in this relation
+   * matches at most one tuple in R, and the result's attributes all come from
+   * this relation, so look the matching tuples up in R's entries.
    */
-  std::vector<std::pair<int, int> > join_attr_order(res_schema.size());
-  for (int i = 0; i < res_schema.size(); ++i) {
-    bool found = false;
-    // Check for the attribute in the schema of this relation.
-    for (int j = 0; j < schema_size; ++j) {
-      if (schema[j] == res_schema[i]) {
-        join_attr_order[i] = std::make_pair(0, j);
-        found = true;
-        break;
-      }
+  if (join_attr.size() == r_schema.size()) {
+    // Get the positions in this relation's schema of the result attributes.
+    std::vector<int> res_indices(res_schema.size());
+    for (int i = 0; i < res_schema.size(); ++i) {
+      res_indices[i] = schema_map[res_schema[i]];
     }
-    // Check for the attribute in R's index.
-    if (!found) {
-      for (int j = 0; j < r_val_indices.size(); ++j) {
-        if (r_schema[r_val_indices[j]] == res_schema[i]) {
-          join_attr_order[i] = std::make_pair(1, j);
-          break;
+
+    for_each_entry([&](const Tuple &t, LL mult) {
+      // Construct the key.
+      for (int i = 0; i < key_indices.size(); ++i) {
+        key[i] = t[key_indices[i]];
+      }
+      LL r_mult = r.get_multiplicity(key);
+      if (r_mult) {
+        for (int i = 0; i < res_indices.size(); ++i) {
+          join_t[i] = t[res_indices[i]];
         }
+        res.update_tuple(join_t, mult * r_mult);
       }
-    }
+    });
+
+    return res;
   }
 
   /**
-   * The hash index on R will map each unique tuple of join attributes to a pair
-   * consisting of a tuple of the remaining attributes, and the multiplicity of
-   * the original full tuple.
+   * Get R's index on the join attributes, which maps each unique tuple of join
+   * attributes to the tuples of remaining attributes and their multiplicities.
+   * Build a temporary one if R does not maintain such an index.
    */
-  std::unordered_multimap<Tuple, std::pair<Tuple, LL>, container_hash<Tuple> > 
-      r_index;
-  Tuple index_key(r_key_indices.size());
-  Tuple index_val(r_val_indices.size());
-  for (auto t : r_entries) {
-    // Construct the key for tuple t.
-    for (int i = 0; i < r_key_indices.size(); ++i) {
-      index_key[i] = (t.first[r_key_indices[i]]);
-    }
-    // Construct the value for tuple t.
-    for (int i = 0; i < r_val_indices.size(); ++i) {
-      index_val[i] = (t.first[r_val_indices[i]]);
-    }
-    // Insert the mapping in the index.
-    r_index.insert(std::make_pair(index_key, 
-        std::make_pair(index_val, t.second)));
+  const SecondaryIndex *r_index = r.get_index(join_attr);
+  SecondaryIndex temp_index(r_schema, join_attr, resource);
+  if (!r_index) {
+    r.for_each_entry([&](const Tuple &t, LL mult) {
+      temp_index.update_tuple(t, mult);
+    });
+    r_index = &temp_index;
   }
+  const std::vector<int> &r_val_indices = r_index->get_val_indices();
+
+  /**
+   * Get information on where to look for the value needed to construct result
+   * tuples. This will be used during the joining of the two relations, when
+   * iterating through the relation's tuples and checking R's tuples through the
+   * index.
+   *
+   * The values of the successfully joined tuples will be obtained either from 
+   * the current tuple in this relation, or the tuple of remaining values in R's
+   * index. As such, a vector detailing the join attribute order will be created
+   * here, specifying for each attribute where to look for its value (in the
+   * current tuple of this relation or in R's index), and at which index.
+   */
+  std::vector<std::pair<int, int> > join_attr_order = get_join_attr_order(
+      schema, r_schema, r_val_indices, res_schema);
 
   /**
    * Perform the actual join by going through all tuples in this relation,
    * constructing a key based on the tuple's values, and looking up the
-   * corresponding value in R's index, if it exists.
+   * corresponding values in R's index, if they exist.
    *
-   * If a value is found, create the resulting join tuple and add it to the
+   * For each value found, create the resulting join tuple and add it to the
    * resulting relation.
    */
-  Tuple key(join_attr.size());
-  Tuple join_t(res_schema.size());
-  for (auto t : entries) {
+  for_each_entry([&](const Tuple &t, LL mult) {
     // Construct the key.
-    for (int i = 0; i < join_attr.size(); ++i) {
-      key[i] = t.first[schema_map[join_attr[i]]];
+    for (int i = 0; i < key_indices.size(); ++i) {
+      key[i] = t[key_indices[i]];
     }
 
     // Get the corresponding values.
-    std::pair<std::unordered_multimap<Tuple, std::pair<Tuple, LL>, 
-        container_hash<Tuple> >::iterator,
-        std::unordered_multimap<Tuple, std::pair<Tuple, LL>, 
-        container_hash<Tuple> >::iterator> vals = r_index.equal_range(key);
-
-    // Go through the values and join the ones with non-zero multiplicity.
-    for (std::unordered_multimap<Tuple, std::pair<Tuple, LL>, 
-        container_hash<Tuple> >::iterator it = vals.first; it != vals.second;
-        ++it) {
-      if (it->second.second) {
-        int j = 0;
-        // Construct the join tuple.
-        for (auto p : join_attr_order) {
-          if (p.first) {
-            join_t[j++] = it->second.first[p.second];
-          } else {
-            join_t[j++] = t.first[p.second];
-          }
+    const SecondaryIndex::Bucket *vals = r_index->lookup(key);
+    if (!vals) {
+      return;
+    }
+
+    // Go through the values and join them, as they all have non-zero counts.
+    for (const auto &v : *vals) {
+      int j = 0;
+      // Construct the join tuple.
+      for (const auto &p : join_attr_order) {
+        if (p.first) {
+          join_t[j++] = v.first[p.second];
+        } else {
+          join_t[j++] = t[p.second];
         }
-        // Insert the join tuple in the resulting relation.
-        res.update_tuple(join_t, t.second * it->second.second);
       }
+      // Insert the join tuple in the resulting relation.
+      res.update_tuple(join_t, mult * v.second);
     }
-  }
+  });
 
   return res;
 }
 
 
-// Update a tuple with a given multiplicity (or add it if it does not exist).
-void Relation::update_tuple(const Tuple &t, int multiplicity) {
+/**
+ * Count the tuples in the join of this relation with another relation, R, as
+ * given by the sum of their multiplicities, without building the join. Each
+ * tuple in this relation adds its multiplicity times that of each tuple of R it
+ * matches, found in the same way as in join_group_by, including in parallel,
+ * in which case each task sums the matches of its own partition. Otherwise,
+ * the products are collected a block at a time and added up with the sum
+ * kernel. If the join is on the whole schema of both relations, the smaller
+ * one is scanned, which in naive mode is often a base relation.
+ */
+LL Relation::join_count(const Relation &r, ThreadPool *pool) const {
+  Schema join_attr = HelperFunctions::schema_intersection(schema, r.schema);
+
+  if (pool && pool->size() > 1 && size() >= PARALLEL_JOIN_MIN_SIZE) {
+    int part_bits = get_partition_bits(pool->size());
+    std::vector<LL> part_counts(1 << part_bits, 0);
+    partitioned_join(*this, r, join_attr, *pool, part_bits, 
+        [&](int p, const Tuple &, const Tuple &, LL mult) {
+      part_counts[p] += mult;
+    });
+
+    return std::accumulate(part_counts.begin(), part_counts.end(), 0LL);
+  }
+
+  // Get the positions in this relation's schema of the join attributes.
+  std::vector<int> key_indices(join_attr.size());
+  for (int i = 0; i < join_attr.size(); ++i) {
+    key_indices[i] = schema_map.at(join_attr[i]);
+  }
+  Tuple key(join_attr.size());
+  LL total_count = 0;
+  LL products[COUNT_BLOCK_SIZE];
+  std::size_t num_products = 0;
+  auto add_product = [&](LL product) {
+    products[num_products++] = product;
+    if (num_products == COUNT_BLOCK_SIZE) {
+      total_count += ColumnKernels::sum(products, num_products);
+      num_products = 0;
+    }
+  };
+
+  // Probe R's entries directly if the key is made of R's whole schema.
+  if (join_attr.size() == r.schema.size()) {
+    if (join_attr.size() == schema.size() && r.size() < size()) {
+      return r.join_count(*this, pool);
+    }
+
+    for_each_entry([&](const Tuple &t, LL mult) {
+      for (int i = 0; i < key_indices.size(); ++i) {
+        key[i] = t[key_indices[i]];
+      }
+      LL r_mult = r.get_multiplicity(key);
+      if (r_mult) {
+        add_product(mult * r_mult);
+      }
+    });
+
+    return total_count + ColumnKernels::sum(products, num_products);
+  }
+
+  // Otherwise, probe R's index on the join attributes, or a temporary one.
+  const SecondaryIndex *r_index = r.get_index(join_attr);
+  SecondaryIndex temp_index(r.schema, join_attr);
+  if (!r_index) {
+    r.for_each_entry([&](const Tuple &t, LL mult) {
+      temp_index.update_tuple(t, mult);
+    });
+    r_index = &temp_index;
+  }
+
+  for_each_entry([&](const Tuple &t, LL mult) {
+    for (int i = 0; i < key_indices.size(); ++i) {
+      key[i] = t[key_indices[i]];
+    }
+    const SecondaryIndex::Bucket *vals = r_index->lookup(key);
+    if (!vals) {
+      return;
+    }
+    for (const auto &v : *vals) {
+      add_product(mult * v.second);
+    }
+  });
+
+  return total_count + ColumnKernels::sum(products, num_products);
+}
+
+
+/**
+ * Register a secondary index on the given (sorted) attributes. The index is
+ * populated with the current entries, then maintained on every update, and it
+ * is used by joins with this relation on exactly these attributes. Return the
+ * number of the index, which stays valid until the indexes are cleared.
+ */
+int Relation::add_index(const Schema &key_attrs) {
+  for (int i = 0; i < indexes.size(); ++i) {
+    if (indexes[i].get_key_attrs() == key_attrs) {
+      return i;
+    }
+  }
+
+  SecondaryIndex index(schema, key_attrs, entries.get_resource());
+  for_each_entry([&](const Tuple &t, LL mult) {
+    index.update_tuple(t, mult);
+  });
+  indexes.push_back(index);
+
+  return indexes.size() - 1;
+}
+
+
+/**
+ * Register a sorted index on the given (sorted) attributes, which must be all
+ * but one of the attributes of the relation. The index is populated with the
+ * current entries, then maintained on every update. Return the number of the
+ * index, which stays valid until the indexes are cleared.
+ */
+int Relation::add_sorted_index(const Schema &key_attrs) {
+  for (int i = 0; i < sorted_indexes.size(); ++i) {
+    if (sorted_indexes[i].get_key_attrs() == key_attrs) {
+      return i;
+    }
+  }
+
+  SortedIndex index(schema, key_attrs, entries.get_resource());
+  for_each_entry([&](const Tuple &t, LL mult) {
+    index.update_tuple(t, mult);
+  });
+  sorted_indexes.push_back(index);
+
+  return sorted_indexes.size() - 1;
+}
+
+
+// Remove all the secondary and sorted indexes registered on the relation.
+void Relation::clear_indexes() {
+  indexes.clear();
+  sorted_indexes.clear();
+}
+
+
+/**
+ * Start keeping the distinct values of each attribute, counting the tuples each
+ * value appears in, so that the numbers of distinct values stay exact under
+ * deletions. If the values are dense IDs, the sets are direct-indexed.
+ */
+void Relation::add_statistics(bool dense_ids) {
+  if (has_statistics) {
+    return;
+  }
+
+  has_statistics = true;
+  for (int i = 0; i < schema_size; ++i) {
+    attr_values.emplace_back(dense_ids, entries.get_resource());
+  }
+  for_each_entry([&](const Tuple &t, LL) {
+    for (int i = 0; i < schema_size; ++i) {
+      attr_values[i].insert(t[i]);
+    }
+  });
+}
+
+
+/**
+ * Register a trie index on the whole schema, in the order of the attributes in
+ * the schema. It is populated with the current entries, then maintained on
+ * every update.
+ */
+void Relation::add_trie_index() {
+  if (has_trie) {
+    return;
+  }
+
+  has_trie = true;
+  for_each_entry([&](const Tuple &t, LL mult) {
+    trie.update_tuple(t, mult);
+  });
+}
+
+
+/**
+ * Update a tuple with a given multiplicity (or add it if it does not exist).
+ * A tuple whose multiplicity drops to zero is removed. In columnar storage, the
+ * last row is moved into its place, so that the columns stay compact.
+ */
+void Relation::update_tuple(const Tuple &t, LL multiplicity) {
   assert(t.size() == schema.size());
   assert(multiplicity);
 
-  entries[t] += multiplicity;
+  bool added;
+  bool removed;
+
+  if (columnar) {
+    // Append a new row for a new tuple.
+    auto row = row_index.try_emplace(t, mults.size());
+    added = row.second;
+    if (added) {
+      for (int i = 0; i < schema_size; ++i) {
+        columns[i].push_back(t[i]);
+      }
+      mults.push_back(0);
+    }
+    std::size_t pos = row.first->second;
+    mults[pos] += multiplicity;
+    removed = !mults[pos];
+
+    if (removed) {
+      row_index.erase(row.first);
+      // Move the last row into the freed one, and update its position.
+      std::size_t last = mults.size() - 1;
+      if (pos != last) {
+        Tuple moved(schema_size);
+        for (int i = 0; i < schema_size; ++i) {
+          moved[i] = columns[i][pos] = columns[i][last];
+        }
+        mults[pos] = mults[last];
+        row_index.find(moved)->second = pos;
+      }
+      for (int i = 0; i < schema_size; ++i) {
+        columns[i].pop_back();
+      }
+      mults.pop_back();
+    }
+  } else {
+    auto entry = entries.try_emplace(t, 0);
+    added = entry.second;
+    entry.first->second += multiplicity;
+    removed = !entry.first->second;
+    if (removed) {
+      entries.erase(entry.first);
+    }
+  }
+
+  // Keep the statistics up to date when the tuple appears or disappears.
+  if (has_statistics && (added || removed)) {
+    for (int i = 0; i < schema_size; ++i) {
+      if (added) {
+        attr_values[i].insert(t[i]);
+      } else {
+        attr_values[i].erase(t[i]);
+      }
+    }
+  }
+
+  // Keep the secondary and sorted indexes up to date.
+  for (auto &index : indexes) {
+    index.update_tuple(t, multiplicity);
+  }
+  for (auto &index : sorted_indexes) {
+    index.update_tuple(t, multiplicity);
+  }
+  if (has_trie) {
+    trie.update_tuple(t, multiplicity);
+  }
 }
 
 
 // Print a list of tuples in the relation and their multiplicities.
 void Relation::print_contents() const {
   // Print a header made of the names of the attributes, in order.
-  for (auto attr : schema) {
+  for (const auto &attr : schema) {
     std::cout << attr << " ";
   }
   std::cout << "[#]\n";
 
   // Go through the entries and print those with non-zero multiplicity.
-  for (auto e : entries) {
-    if (e.second == 0) {
-      continue;
-    }
+  for_each_entry([](const Tuple &t, LL mult) {
     // Print the attribute values.
-    for (int i = 0; i < e.first.size(); ++i) {
-      std::cout << e.first[i] << " ";
+    for (int i = 0; i < t.size(); ++i) {
+      std::cout << t[i] << " ";
     }
     // Print the multiplicity.
-    std::cout << "[" << e.second << "]\n";
-  }
+    std::cout << "[" << mult << "]\n";
+  });
 }
 
 
@@ -237,43 +692,87 @@ void Relation::print_contents() const {
  * Accessors
  * ========= */
 
+// Get the number of tuples with non-zero multiplicity in the relation.
+std::size_t Relation::size() const {
+  return columnar ? mults.size() : entries.size();
+}
+
+
 // Return true if the relation contains no tuples with non-zero multiplicity.
 bool Relation::empty() const {
-  return entries.empty();
+  return columnar ? mults.empty() : entries.empty();
 }
 
 
 // Get the entries in the relation as a map of tuples to multiplicities.
-std::unordered_map<Tuple, LL, container_hash<Tuple> > 
-    Relation::get_entries() const {
+const TupleMap &Relation::get_entries() const {
+  assert(!columnar);
+
   return entries;
 }
 
 
+// Get the secondary index on the given attributes, or nullptr if none exists.
+const SecondaryIndex *Relation::get_index(const Schema &key_attrs) const {
+  for (const auto &index : indexes) {
+    if (index.get_key_attrs() == key_attrs) {
+      return &index;
+    }
+  }
+
+  return nullptr;
+}
+
+
+// Get the secondary index with the given number, as returned by add_index.
+const SecondaryIndex &Relation::get_index(int index_num) const {
+  return indexes[index_num];
+}
+
+
+// Get the sorted index with the given number, from add_sorted_index.
+const SortedIndex &Relation::get_sorted_index(int index_num) const {
+  return sorted_indexes[index_num];
+}
+
+
+// Get the number of distinct values of an attribute, if statistics are kept.
+std::size_t Relation::get_distinct_count(int attr_index) const {
+  assert(has_statistics);
+
+  return attr_values[attr_index].size();
+}
+
+
+// Get the trie index, or nullptr if none exists.
+const TrieIndex *Relation::get_trie_index() const {
+  return has_trie ? &trie : nullptr;
+}
+
+
 // Get the multiplicity of a given tuple.
 LL Relation::get_multiplicity(const Tuple &t) const {
   assert(t.size() == schema.size());
 
-  LL res;
-  // Check if the tuple exists in the map.
-  try {
-    res = entries.at(t);
-  } catch (std::out_of_range e) {
-    res = 0;
+  // Check if the tuple exists in the map, or in the columns.
+  if (columnar) {
+    auto row = row_index.find(t);
+    return row == row_index.end() ? 0 : mults[row->second];
   }
+  auto it = entries.find(t);
 
-  return res;
+  return it == entries.end() ? 0 : it->second;
 }
 
 
 // Get the schema of the relation.
-Schema Relation::get_schema() const {
+const Schema &Relation::get_schema() const {
   return schema;
 }
 
 
 // Get the schema map of the relation.
-std::map<std::string, int> Relation::get_schema_map() const {
+const std::map<std::string, int> &Relation::get_schema_map() const {
   return schema_map;
 }
 
@@ -281,4 +780,10 @@ std::map<std::string, int> Relation::get_schema_map() const {
 // Get the number of attributes in the relation.
 int Relation::get_schema_size() const {
   return schema_size;
+}
+
+
+// Return true if the relation is stored in columns.
+bool Relation::is_columnar() const {
+  return columnar;
 }
\ No newline at end of file
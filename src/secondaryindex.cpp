@@ -0,0 +1,84 @@
+#include <ivm/secondaryindex.h>
+
+#include <cassert>
+
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * Split the schema of the indexed relation into the key attributes and the
+ * remaining ones. Both the schema and the key attributes are sorted, so a
+ * single pass is enough.
+ */
+SecondaryIndex::SecondaryIndex(const Schema &schema, const Schema &key_attrs_,
+    std::pmr::memory_resource *resource) : entries(resource) {
+  key_attrs = key_attrs_;
+
+  for (int i = 0, j = 0; i < schema.size(); ++i) {
+    if (j < key_attrs.size() && schema[i] == key_attrs[j]) {
+      key_indices.push_back(i);
+      j++;
+    } else {
+      val_indices.push_back(i);
+    }
+  }
+  assert(key_indices.size() == key_attrs.size());
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Add the multiplicity change of tuple t to the index. Values whose
+ * multiplicity drops to 0 are removed, along with keys left with no values, so
+ * the size of the index follows the live contents of the relation.
+ */
+void SecondaryIndex::update_tuple(const Tuple &t, LL multiplicity) {
+  Tuple key(key_indices.size());
+  Tuple val(val_indices.size());
+  for (int i = 0; i < key_indices.size(); ++i) {
+    key[i] = t[key_indices[i]];
+  }
+  for (int i = 0; i < val_indices.size(); ++i) {
+    val[i] = t[val_indices[i]];
+  }
+
+  Bucket &bucket = 
+      entries.try_emplace(key, entries.get_resource()).first->second;
+  LL &mult = bucket[val];
+  mult += multiplicity;
+  if (!mult) {
+    bucket.erase(val);
+    if (bucket.empty()) {
+      entries.erase(key);
+    }
+  }
+}
+
+
+// Get the entries matching a given key, or nullptr if there are none.
+const SecondaryIndex::Bucket *SecondaryIndex::lookup(const Tuple &key) const {
+  auto it = entries.find(key);
+
+  return it == entries.end() ? nullptr : &it->second;
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+// Get the attributes the index is built on.
+const Schema &SecondaryIndex::get_key_attrs() const {
+  return key_attrs;
+}
+
+
+// Get the positions in the relation's schema of the non-key attributes.
+const std::vector<int> &SecondaryIndex::get_val_indices() const {
+  return val_indices;
+}
@@ -1,110 +1,472 @@
-#include <ivm/helperfunctions.h>
 #include <ivm/skewprocessor.h>
-#include <ivm/skewrelation.h>
 
-#include <iostream>
+#include <cstdlib>
 
 
-SkewProcessor::SkewProcessor(int n_) {
-  n = n_;
+/**
+ * The sources of the values of the missing attribute used to maintain a view,
+ * besides the matches of a relation: none, if the view does not change, or the
+ * heavy values of the previous relation.
+ */
+const int NO_SOURCE = -2;
+const int HEAVY_SOURCE = -1;
 
-  Schema schema(n - 1);
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * Initialise a skew processor with n relations, partitioned on their first
+ * attributes in the cycle, and the view of each relation. Each relation gets an
+ * index on the attributes it shares with each other one, for the matches of
+ * updates to the other relation. The skew relations hold the tuples, so the
+ * base relations are left empty.
+ */
+SkewProcessor::SkewProcessor(int n_, const Options &options_) : 
+    IVMProcessor(n_, options_) {
+  current_count = 0;
+  epsilon = options.epsilon >= 0 ? options.epsilon : EPSILON;
+  light_work = heavy_work = 0;
+  tuning_updates = 0;
+
+  skew_rels.reserve(n);
+  views.reserve(n);
   for (int i = 0; i < n; ++i) {
-    for (int j = 1; j < n; ++j) {
-      // Compute the attribute index.
-      int idx = i + j > n ? (i + j) % n : i + j;
-      schema[j - 1] = "A" + std::to_string(idx);
+    std::string skew_attr = "A" + std::to_string(i + 1);
+    skew_rels.push_back(SkewRelation(rels[i].get_schema(), skew_attr, epsilon,
+        options.dense_ids, &storage_pool, options.columnar));
+    views.push_back(View(rels[i].get_schema(), &storage_pool));
+  }
+
+  shared_indexes.assign(n, std::vector<int>(n, -1));
+  skew_positions.assign(n, std::vector<int>(n, -1));
+  for (int r = 0; r < n; ++r) {
+    for (int j = 0; j < n; ++j) {
+      if (j != r) {
+        shared_indexes[r][j] = skew_rels[j].add_index(
+            plans[r].get_shared_attrs(j));
+      }
+
+      const std::map<std::string, int> &sm = rels[r].get_schema_map();
+      auto it = sm.find("A" + std::to_string(j + 1));
+      if (it != sm.end()) {
+        skew_positions[r][j] = it->second;
+      }
     }
-    // Create a new relation.
-    rels.push_back(Relation(schema));
-    skew_rels.push_back(SkewRelation(schema, "A" + std::to_string(i + 1), 
-        EPSILON));
   }
+
+  matches.assign(n, nullptr);
+  view_sources.assign(n, NO_SOURCE);
 }
 
 
-LL SkewProcessor::delta_update(int rel_num, const Tuple &t, int multiplicity,
-    int next_rel_num, const std::vector<bool> &skew_config) {
-  std::string missing_attr = rel_num == 0 ? 
-      "A" + std::to_string(n) : "A" + std::to_string(rel_num);
-  int missing_idx = rels[next_rel_num].get_schema_map()[missing_attr];
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Given an update to a relation, update the current count, then maintain the
+ * views of the other relations with the update in its current part. Then update
+ * the relation, and for each partition value whose tuples have moved to the
+ * other part, maintain the views as for their deletion from one part and
+ * insertion into the other. Every so often, epsilon is tuned, unless it was
+ * given. None of the views of the other relations is needed
+ * to update the count, and none is computed from the updated relation's own
+ * view, so the order of the steps does not change the result.
+ */
+LL SkewProcessor::update_and_count(int rel_num, const Tuple &t, 
+    int multiplicity) {
+  find_matches(rel_num, t);
+  current_count += get_delta_count(rel_num, t, multiplicity);
 
-  std::vector<std::pair<Tuple, int> > keys = HelperFunctions::generate_keys(
-      rels, t, rel_num, missing_attr);
+  Value skew_value = get_skew_value(rel_num, t, rel_num);
+  update_views(rel_num, t, multiplicity, 
+      skew_rels[rel_num].is_heavy(skew_value));
 
-  std::unordered_map<Tuple, LL, container_hash<Tuple> > entries = 
-      skew_config[next_rel_num] ? 
-      skew_rels[next_rel_num].get_heavy_part().get_entries() :
-      skew_rels[next_rel_num].get_light_part().get_entries();
-  std::unordered_set<LL> missing_vals;
-  for (auto e : entries) {
-    if (e.second)
-      missing_vals.insert(e.first[missing_idx]);
+  moved_values.clear();
+  skew_rels[rel_num].update_tuple(t, multiplicity, moved_values);
+  for (Value val : moved_values) {
+    migrate(rel_num, val);
   }
-  for (auto v : missing_vals) {
-    LL delta_count = multiplicity;
 
-    for (int i = 0; i < n; ++i) {
-      if (i == rel_num) {
-        continue;
+  if (options.epsilon < 0 && ++tuning_updates == TUNING_PERIOD) {
+    tune_epsilon();
+  }
+
+  return current_count;
+}
+
+
+/**
+ * Given a batch of updates to a relation, merge them into a delta relation, so
+ * that repeated updates to a tuple are processed once, and cancelling ones not
+ * at all, then process the remaining tuples one at a time.
+ */
+LL SkewProcessor::update_and_count_batch(int rel_num, 
+    const UpdateBatch &batch) {
+  Relation delta_rel = coalesce_batch(rel_num, batch, 
+      std::pmr::get_default_resource());
+  delta_rel.for_each_entry([&](const Tuple &t, LL mult) {
+    update_and_count(rel_num, t, mult);
+  });
+
+  return current_count;
+}
+
+
+/**
+ * Given an update to a relation, fill the keys of the other relations with the
+ * values of the update tuple, and look up the tuples of each other relation
+ * which match it on all the attributes they share.
+ */
+void SkewProcessor::find_matches(int rel_num, const Tuple &t) {
+  const UpdatePlan &plan = plans[rel_num];
+  plan.fill_keys(t, keys);
+
+  Tuple shared_key(n - 2);
+  for (int j = 0; j < n; ++j) {
+    if (j == rel_num) {
+      continue;
+    }
+    plan.fill_shared_key(t, j, shared_key);
+    matches[j] = skew_rels[j].get_index(shared_indexes[rel_num][j]).lookup(
+        shared_key);
+  }
+}
+
+
+/**
+ * Get the change of the count caused by an update to a relation, whose matches
+ * have been found. If one of the partition values fixed by the update is light,
+ * or if the previous relation has fewer heavy values of the missing attribute
+ * than tuples in the smallest set of matches, then the matches are enumerated
+ * as in delta processing. Otherwise, the view of the relation gives the count
+ * for the light values of the missing attribute, and the heavy ones are probed
+ * one by one, split between the threads if there are many.
+ */
+LL SkewProcessor::get_delta_count(int rel_num, const Tuple &t, 
+    int multiplicity) {
+  int prev_rel_num = (rel_num + n - 1) % n;
+
+  // Find the relation with the fewest tuples matching the update.
+  int candidate_rel_num = -1;
+  for (int j = 0; j < n; ++j) {
+    if (j == rel_num) {
+      continue;
+    }
+    // If a relation has no matching tuples, then the count does not change.
+    if (!matches[j]) {
+      return 0;
+    }
+    if (candidate_rel_num < 0 || 
+        matches[j]->size() < matches[candidate_rel_num]->size()) {
+      candidate_rel_num = j;
+    }
+  }
+
+  bool all_heavy = true;
+  for (int j = 0; j < n; ++j) {
+    if (j != rel_num && j != prev_rel_num && 
+        !skew_rels[j].is_heavy(get_skew_value(rel_num, t, j))) {
+      all_heavy = false;
+      break;
+    }
+  }
+
+  LL delta_count = 0;
+  const ValueSet &heavy_values = skew_rels[prev_rel_num].get_heavy_values();
+  if (!all_heavy || 
+      matches[candidate_rel_num]->size() <= heavy_values.size()) {
+    light_work += matches[candidate_rel_num]->size();
+    for (const auto &e : *matches[candidate_rel_num]) {
+      delta_count += probe(keys, multiplicity * e.second, e.first[0], rel_num,
+          -1, candidate_rel_num);
+    }
+    return delta_count;
+  }
+
+  heavy_work += heavy_values.size();
+  delta_count = multiplicity * views[rel_num].get_multiplicity(t);
+
+  // Split many heavy values between the threads, each with its own keys.
+  if (pool.size() > 1 && heavy_values.size() >= options.parallel_threshold) {
+    std::vector<LL> chunk_counts(pool.get_num_chunks(), 0);
+    pool.parallel_for_chunks(heavy_values.size(), 
+        [&](int chunk, std::size_t begin, std::size_t end) {
+      std::vector<Tuple> chunk_keys = keys;
+      for (auto it = heavy_values.begin() + begin; 
+          it != heavy_values.begin() + end; ++it) {
+        chunk_counts[chunk] += probe(chunk_keys, multiplicity, *it, rel_num, 
+            -1, -1);
       }
-      // Fill the empty slot in the key.
-      keys[i].first[keys[i].second] = v;
-      // Get the count for the constructed tuple.
-      Relation rel_to_get = skew_config[i] ? 
-          skew_rels[i].get_heavy_part() :
-          skew_rels[i].get_light_part();
-      if (!skew_config[i]) {
-        // if (skew_rels[i].get_light_part().has_tuple(keys[i].first))
-        delta_count *= skew_rels[i].get_light_part().get_multiplicity(keys[i].first);
-        // if (skew_rels[i].get_light_part().get_multiplicity(keys[i].first))
-          //std::cout<<skew_rels[i].get_light_part().get_multiplicity(keys[i].first)<<'\n';
-      } else {
-        // if (skew_rels[i].get_heavy_part().has_tuple(keys[i].first))
-        delta_count *= skew_rels[i].get_heavy_part().get_multiplicity(keys[i].first);
-        // if (skew_rels[i].get_heavy_part().get_multiplicity(keys[i].first))
-          //std::cout<<skew_rels[i].get_heavy_part().get_multiplicity(keys[i].first)<<'\n';
+    });
+    for (LL chunk_count : chunk_counts) {
+      delta_count += chunk_count;
+    }
+    return delta_count;
+  }
+
+  for (Value v : heavy_values) {
+    delta_count += probe(keys, multiplicity, v, rel_num, -1, -1);
+  }
+
+  return delta_count;
+}
+
+
+/**
+ * Maintain the views after an update to the given part of a relation, whose
+ * matches have been found. The view of relation r joins the light part of
+ * relation r - 1 with the heavy parts of the others, so an update to a light
+ * part only changes the view of the next relation, and one to a heavy part the
+ * views of the relations other than the next one.
+ *
+ * The changes of the views are independent of each other, so once the source
+ * of the values of each view is known, large ones are computed in parallel,
+ * one view per task. Each task probes with its own keys, and collects its view
+ * updates, which are then applied one view after the other, as the views share
+ * a memory pool.
+ */
+void SkewProcessor::update_views(int rel_num, const Tuple &t, LL multiplicity,
+    bool heavy) {
+  int next_rel_num = (rel_num + 1) % n;
+
+  int num_views = 0;
+  std::size_t total_work = 0;
+  for (int i = 0; i < n; ++i) {
+    view_sources[i] = NO_SOURCE;
+    if (i == rel_num || heavy == (i == next_rel_num)) {
+      continue;
+    }
+
+    view_sources[i] = get_view_source(rel_num, t, i);
+    if (view_sources[i] == HEAVY_SOURCE) {
+      std::size_t work = 
+          skew_rels[(rel_num + n - 1) % n].get_heavy_values().size();
+      heavy_work += work;
+      total_work += work;
+      num_views++;
+    } else if (view_sources[i] != NO_SOURCE) {
+      std::size_t work = matches[view_sources[i]]->size();
+      light_work += work;
+      total_work += work;
+      num_views++;
+    }
+  }
+
+  if (pool.size() > 1 && num_views > 1 && 
+      total_work >= options.parallel_threshold) {
+    std::vector<std::vector<std::pair<Tuple, LL> > > view_updates(n);
+    pool.parallel_for(n, [&](int i) {
+      if (view_sources[i] != NO_SOURCE) {
+        std::vector<Tuple> task_keys = keys;
+        update_view(i, rel_num, view_sources[i], multiplicity, task_keys, 
+            [&](const Tuple &key, LL delta_count) {
+          view_updates[i].emplace_back(key, delta_count);
+        });
       }
-      // If the count becomes 0, then stop looking through the other relations.
-      if (!delta_count) {
-        break;
+    });
+    for (int i = 0; i < n; ++i) {
+      for (const auto &update : view_updates[i]) {
+        views[i].update_tuple(update.first, update.second);
       }
     }
-    current_count += delta_count;
+    return;
   }
 
-  return current_count;
+  for (int i = 0; i < n; ++i) {
+    if (view_sources[i] != NO_SOURCE) {
+      update_view(i, rel_num, view_sources[i], multiplicity, keys,
+          [&](const Tuple &key, LL delta_count) {
+        views[i].update_tuple(key, delta_count);
+      });
+    }
+  }
 }
 
 
-LL SkewProcessor::update_and_count(int rel_num, const Tuple &t, 
-    int multiplicity) {
-  skew_rels[rel_num].update_tuple(t, multiplicity);
-
-  std::vector<bool> skew_config(n, false);
-  int num_of_configs = pow(2, n - 1);
-  int missing_attr_idx = rel_num == 0 ? n : rel_num - 1;
-
-  for (int i = 0; i < num_of_configs; ++i) {
-    bool has_light = false;
-    int source_rel = -1;
-
-    for (int j = 0; j < skew_config.size(); ++j) {
-      if (j == missing_attr_idx && j == rel_num) continue;
-      if (skew_config[j] == false) {
-        has_light = true;
-        source_rel = j;
-        break;
+/**
+ * Given an update to a relation, get where to take the values of the missing
+ * attribute from to maintain a view, or NO_SOURCE if the view does not change.
+ *
+ * The change of a view is the join of the update tuple with the other parts it
+ * is computed from, grouped by the values of the attribute missing from the
+ * update tuple. If one of these parts is a heavy part with no heavy values, the
+ * view is always empty, and is skipped before any lookup. The partition values
+ * of all these parts but the one of the previous relation are fixed by the
+ * update tuple, and the view does not change unless they are in the right
+ * parts. The values of the missing attribute are then taken either from the
+ * relation with the fewest matches, or from the heavy values of the previous
+ * relation, which is in the view with its heavy part unless it is the view's
+ * relation, whichever are fewer.
+ */
+int SkewProcessor::get_view_source(int rel_num, const Tuple &t, int view_num) {
+  int prev_rel_num = (rel_num + n - 1) % n;
+  int view_prev_rel_num = (view_num + n - 1) % n;
+
+  for (int j = 0; j < n; ++j) {
+    if (j != view_num && j != rel_num && j != view_prev_rel_num &&
+        !skew_rels[j].get_heavy_values().size()) {
+      return NO_SOURCE;
+    }
+  }
+
+  // Check the parts with partition values fixed by the update tuple.
+  int candidate_rel_num = -1;
+  for (int j = 0; j < n; ++j) {
+    if (j == view_num || j == rel_num) {
+      continue;
+    }
+    if (!matches[j]) {
+      return NO_SOURCE;
+    }
+    if (j != prev_rel_num && 
+        skew_rels[j].is_heavy(get_skew_value(rel_num, t, j)) != 
+            (j != view_prev_rel_num)) {
+      return NO_SOURCE;
+    }
+    if (candidate_rel_num < 0 || 
+        matches[j]->size() < matches[candidate_rel_num]->size()) {
+      candidate_rel_num = j;
+    }
+  }
+
+  if (prev_rel_num != view_num && 
+      skew_rels[prev_rel_num].get_heavy_values().size() < 
+          matches[candidate_rel_num]->size()) {
+    return HEAVY_SOURCE;
+  }
+
+  return candidate_rel_num;
+}
+
+
+/**
+ * Compute the change of a view after an update to a relation, taking the values
+ * of the missing attribute from the given source, and probing the relations
+ * with the given keys. Each tuple of the change is passed to a function along
+ * with its multiplicity.
+ */
+template <typename F>
+void SkewProcessor::update_view(int view_num, int rel_num, int source,
+    LL multiplicity, std::vector<Tuple> &keys, F f) const {
+  int prev_rel_num = (rel_num + n - 1) % n;
+  int slot = plans[rel_num].get_missing_slot(view_num);
+  const SkewRelation &prev_rel = skew_rels[prev_rel_num];
+
+  if (source == HEAVY_SOURCE) {
+    for (Value v : prev_rel.get_heavy_values()) {
+      LL delta_count = probe(keys, multiplicity, v, rel_num, view_num, -1);
+      if (delta_count) {
+        keys[view_num][slot] = v;
+        f(keys[view_num], delta_count);
       }
     }
-    current_count += delta_update(rel_num, t, multiplicity, (rel_num + 1) % n, skew_config);
-    // if (has_light || skew_config[missing_attr_idx]) {
-    //   if (source_rel == -1) source_rel = missing_attr_idx - 1;
-    //   current_count += delta_update(rel_num, t, multiplicity, source_rel, skew_config);
-    // } else {
-    //   //view_update();
-    // }
+    return;
   }
 
-  return current_count;
-}
\ No newline at end of file
+  for (const auto &e : *matches[source]) {
+    Value v = e.first[0];
+    if (prev_rel_num != view_num && !prev_rel.is_heavy(v)) {
+      continue;
+    }
+    LL delta_count = probe(keys, multiplicity * e.second, v, rel_num, 
+        view_num, source);
+    if (delta_count) {
+      keys[view_num][slot] = v;
+      f(keys[view_num], delta_count);
+    }
+  }
+}
+
+
+/**
+ * Maintain the views after the tuples of a relation with a given partition
+ * value moved to the other part, by removing each of them from the views of its
+ * old part and adding it to those of its new part.
+ */
+void SkewProcessor::migrate(int rel_num, Value val) {
+  bool heavy = skew_rels[rel_num].is_heavy(val);
+
+  skew_rels[rel_num].for_each_value_tuple(val, [&](const Tuple &t, LL mult) {
+    find_matches(rel_num, t);
+    update_views(rel_num, t, -mult, !heavy);
+    update_views(rel_num, t, mult, heavy);
+  });
+}
+
+
+/**
+ * Multiply a count by the multiplicities of the given keys filled with a value
+ * of the attribute missing from an update to a relation, in each relation but
+ * the updated one, the one of a view being maintained, if any, and the one the
+ * value was taken from, if any.
+ */
+LL SkewProcessor::probe(std::vector<Tuple> &keys, LL delta_count, Value v, 
+    int rel_num, int view_num, int candidate_rel_num) const {
+  const UpdatePlan &plan = plans[rel_num];
+
+  for (int j = 0; j < n && delta_count; ++j) {
+    if (j == rel_num || j == view_num || j == candidate_rel_num) {
+      continue;
+    }
+    keys[j][plan.get_missing_slot(j)] = v;
+    delta_count *= skew_rels[j].get_multiplicity(keys[j]);
+  }
+
+  return delta_count;
+}
+
+
+/**
+ * Move epsilon by a step if one path has done more than twice the work of the
+ * other since it was last tuned: down if it is the light path, so that fewer
+ * values are light and the sets of matches of light values get smaller, or up
+ * if it is the heavy path, so that there are fewer heavy values. The new value
+ * is only taken if the tuples the relations would move to the other partitions
+ * are no more than the difference of work between the paths, and then the
+ * relations move them over the following updates.
+ */
+void SkewProcessor::tune_epsilon() {
+  double new_epsilon = epsilon;
+  if (light_work > 2 * heavy_work) {
+    new_epsilon = std::max(MIN_EPSILON, epsilon - EPSILON_STEP);
+  } else if (heavy_work > 2 * light_work) {
+    new_epsilon = std::min(MAX_EPSILON, epsilon + EPSILON_STEP);
+  }
+  LL saved_work = std::llabs(light_work - heavy_work);
+  light_work = heavy_work = 0;
+  tuning_updates = 0;
+
+  if (new_epsilon == epsilon) {
+    return;
+  }
+
+  LL moved_tuples = 0;
+  for (const auto &skew_rel : skew_rels) {
+    moved_tuples += skew_rel.count_moved_tuples(new_epsilon);
+  }
+  if (moved_tuples > saved_work) {
+    return;
+  }
+
+  epsilon = new_epsilon;
+  for (auto &skew_rel : skew_rels) {
+    skew_rel.set_epsilon(epsilon);
+  }
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+/**
+ * Get the value in a tuple of a relation of the partition attribute of another
+ * relation, which must not be the attribute missing from the tuple.
+ */
+Value SkewProcessor::get_skew_value(int rel_num, const Tuple &t, 
+    int skew_rel_num) const {
+  return t[skew_positions[rel_num][skew_rel_num]];
+}
@@ -3,14 +3,19 @@
 #include <cmath>
 
 
+// The number of values checked after each update during a major re-balance.
+const int REBALANCE_STEP = 4;
+
+
 /**
  * Constructor
  * =========== */
 
-// Initialise the partitions and the skew criteria.
+// Initialise the relation, the index on the skew attribute, and the criteria.
 SkewRelation::SkewRelation(const Schema &schema_, const std::string &skew_attr_,
-    double epsilon_) : Relation(schema_), light_part(schema_), 
-    heavy_part(schema_) {
+    double epsilon_, bool dense_ids, std::pmr::memory_resource *resource,
+    bool columnar_) : Relation(schema_, resource, columnar_), 
+    unchecked_values(resource), heavy_values(dense_ids, resource) {
   // Get the index in the schema of the skew attribute.
   for (int i = 0; i < schema.size(); ++i) {
     if (schema[i] == skew_attr_) {
@@ -18,7 +23,10 @@ SkewRelation::SkewRelation(const Schema &schema_, const std::string &skew_attr_,
       break;
     }
   }
+  skew_index = add_index(Schema(1, skew_attr_));
   epsilon = epsilon_;
+  base_size = 0;
+  heavy_threshold = light_threshold = 0;
 }
 
 
@@ -26,96 +34,126 @@ SkewRelation::SkewRelation(const Schema &schema_, const std::string &skew_attr_,
  * Operations
  * ========== */
 
-// Update a tuple in a partition, then re-balance the partitions for that tuple.
-void SkewRelation::update_tuple(const Tuple &t, int multiplicity) {
-  assert(t.size() == schema.size());
-  assert(multiplicity);
-
-  // Get the tuple's multiplicity in each partition to determine where it is.
-  LL heavy_mult = heavy_part.get_multiplicity(t);
-  LL light_mult = light_part.get_multiplicity(t);
-  // Track where the tuple is put. 0 = in light, 1 = in heavy, 2 = nowhere.
-  int placement;
-
-  // If it's in the heavy partition, update it there.
-  if (heavy_mult) {
-    heavy_part.update_tuple(t, multiplicity);
-    placement = 1;
-    // Check if it has just been deleted.
-    if (!(heavy_mult + multiplicity)) {
-      // Remove it from the tuples associated with this value.
-      skew_tuples[t[skew_attr_idx]].erase(t);
-      // Decrement the size.
-      N--;
-      // If it has been deleted, it doesn't need to be re-balanced.
-      placement = 2;
-    }
-  } else {
-    // If it's in the light partition, update it there.
-    light_part.update_tuple(t, multiplicity);
-    placement = 0;
-    // Check if it has just been deleted.
-    if (!(light_mult + multiplicity)) {
-      // Remove it from the tuples associated with this value.
-      skew_tuples[t[skew_attr_idx]].erase(t);
-      // Decrement the size.
-      N--;
-      // If it has been deleted, it doesn't need to be re-balanced.
-      placement = 2;
-    } else if (!light_mult) {
-      // If it's a new tuple, put it in the light partition.
-      skew_tuples[t[skew_attr_idx]].insert(t);
-      // Increment the size.
-      N++;
-    }
+/**
+ * Update a tuple, then re-balance the partitions for its value of the skew
+ * attribute, and add it to the moved values if its tuples were moved to the
+ * other partition. A value left with no tuples is no longer heavy. If the size
+ * of the relation has doubled or halved since the last major re-balance, start
+ * a new one first, and then check a few more values against the threshold.
+ */
+void SkewRelation::update_tuple(const Tuple &t, int multiplicity,
+    std::vector<Value> &moved_values) {
+  Relation::update_tuple(t, multiplicity);
+
+  Value val = t[skew_attr_idx];
+  if (is_heavy(val) && !get_degree(val)) {
+    heavy_values.erase(val);
+  }
+
+  /**
+   * The threshold only changes before any value is checked, so that the
+   * hysteresis keeps a value from moving twice in a single update.
+   */
+  if (size() > 2 * base_size || 2 * size() < base_size) {
+    start_major_rebalance();
   }
-  // If the tuple still exists in the relation, re-balanceit.
-  if (placement != 2) {
-    rebalance(t[skew_attr_idx], !placement);
+  if (rebalance(val)) {
+    moved_values.push_back(val);
   }
+  continue_major_rebalance(moved_values);
 }
 
 
 /**
- * Given a value for the skew attribute and the partition where the tuples
- * associated with it are currently located, re-balance these tuples if needed.
+ * Given a value for the skew attribute, move its tuples to the other partition
+ * if the number of tuples it is found in is past the threshold of that
+ * partition, and get whether they were moved.
  */
-void SkewRelation::rebalance(LL val, bool in_light) {
-  // Check whether the tuples should be in the light partition or not.
-  bool light = skew_tuples[val].size() <= pow(N, epsilon);
+bool SkewRelation::rebalance(Value val) {
+  bool heavy = is_heavy(val);
+  std::size_t degree = get_degree(val);
 
   // If the tuples are where they should be, then do nothing.
-  if (in_light && light || !in_light && !light) {
-    return;
+  if (heavy ? degree >= light_threshold : degree <= heavy_threshold) {
+    return false;
   }
 
   // Otherwise, move them to the other partition.
-  if (in_light) {
-    for (auto t : skew_tuples[val]) {
-      int mult = light_part.get_multiplicity(t);
-      if (!mult) continue;
-      heavy_part.update_tuple(t, mult);
-      light_part.update_tuple(t, -mult);
-    }
+  if (heavy) {
+    heavy_values.erase(val);
   } else {
-    for (auto t : skew_tuples[val]) {
-      int mult = heavy_part.get_multiplicity(t);
-      if (!mult) continue;
-      light_part.update_tuple(t, mult);
-      heavy_part.update_tuple(t, -mult);
+    heavy_values.insert(val);
+  }
+
+  return true;
+}
+
+
+/**
+ * Reset the threshold to the current size of the relation, and start checking
+ * every value against it. A value checked against the new threshold moves at
+ * most a constant factor of it of tuples, and as the values are checked a few
+ * at a time, they have all been checked before the size doubles or halves
+ * again.
+ */
+void SkewRelation::start_major_rebalance() {
+  base_size = size();
+  double threshold = pow(base_size, epsilon);
+  heavy_threshold = 2 * threshold;
+  light_threshold = threshold / 2;
+
+  unchecked_values.clear();
+  get_index(skew_index).for_each_key(
+      [&](const Tuple &key, const SecondaryIndex::Bucket &) {
+    unchecked_values.push_back(key[0]);
+  });
+}
+
+
+/**
+ * Check a few of the values not checked against the threshold since the last
+ * major re-balance, and add those whose tuples were moved to the moved values.
+ * Values left with no tuples are light, and stay so.
+ */
+void SkewRelation::continue_major_rebalance(std::vector<Value> &moved_values) {
+  for (int i = 0; i < REBALANCE_STEP && !unchecked_values.empty(); ++i) {
+    Value val = unchecked_values.back();
+    unchecked_values.pop_back();
+    if (rebalance(val)) {
+      moved_values.push_back(val);
     }
   }
 }
 
 
-// Print the contents of the heavy partition.
-void SkewRelation::print_heavy_contents() const {
-  heavy_part.print_contents();
+/**
+ * Change the exponent of the threshold. As when the size of the relation has
+ * doubled or halved, the values are then checked against the new threshold a
+ * few at a time over the following updates.
+ */
+void SkewRelation::set_epsilon(double epsilon_) {
+  epsilon = epsilon_;
+  start_major_rebalance();
 }
 
-// Print the contents of the light partition.
-void SkewRelation::print_light_contents() const {
-  light_part.print_contents();
+
+/**
+ * Count the tuples which a major re-balance at the current size would move to
+ * the other partition, with the given exponent of the threshold, going through
+ * the number of tuples each value is found in.
+ */
+std::size_t SkewRelation::count_moved_tuples(double new_epsilon) const {
+  double threshold = pow(size(), new_epsilon);
+  std::size_t moved = 0;
+  get_index(skew_index).for_each_key(
+      [&](const Tuple &key, const SecondaryIndex::Bucket &bucket) {
+    std::size_t degree = bucket.size();
+    if (is_heavy(key[0]) ? degree < threshold / 2 : degree > 2 * threshold) {
+      moved += degree;
+    }
+  });
+
+  return moved;
 }
 
 
@@ -123,13 +161,29 @@ void SkewRelation::print_light_contents() const {
  * Accessors
  * ========= */
 
-// Return the heavy partition.
-Relation SkewRelation::get_heavy_part() const {
-  return heavy_part;
+// Return true if a value of the skew attribute is heavy.
+bool SkewRelation::is_heavy(Value val) const {
+  return heavy_values.contains(val);
 }
 
 
-// Return the light partition.
-Relation SkewRelation::get_light_part() const {
-  return light_part;
-}
\ No newline at end of file
+// Get the heavy values of the skew attribute.
+const ValueSet &SkewRelation::get_heavy_values() const {
+  return heavy_values;
+}
+
+
+// Get the number of tuples a value of the skew attribute is found in.
+std::size_t SkewRelation::get_degree(Value val) const {
+  Tuple key(1);
+  key[0] = val;
+  const SecondaryIndex::Bucket *bucket = get_index(skew_index).lookup(key);
+
+  return bucket ? bucket->size() : 0;
+}
+
+
+// Get the exponent of the threshold.
+double SkewRelation::get_epsilon() const {
+  return epsilon;
+}
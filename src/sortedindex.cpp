@@ -0,0 +1,90 @@
+#include <ivm/sortedindex.h>
+
+#include <algorithm>
+#include <cassert>
+
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * Split the schema of the indexed relation into the key attributes and the
+ * remaining one. Both the schema and the key attributes are sorted, so a
+ * single pass is enough.
+ */
+SortedIndex::SortedIndex(const Schema &schema, const Schema &key_attrs_,
+    std::pmr::memory_resource *resource) : entries(resource) {
+  key_attrs = key_attrs_;
+  val_index = -1;
+
+  for (int i = 0, j = 0; i < schema.size(); ++i) {
+    if (j < key_attrs.size() && schema[i] == key_attrs[j]) {
+      key_indices.push_back(i);
+      j++;
+    } else {
+      assert(val_index < 0);
+      val_index = i;
+    }
+  }
+  assert(key_indices.size() == key_attrs.size() && val_index >= 0);
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Add the multiplicity change of tuple t to the index. A new value is inserted
+ * at its place in the sorted bucket, and values whose multiplicity drops to 0
+ * are removed, along with keys left with no values.
+ */
+void SortedIndex::update_tuple(const Tuple &t, LL multiplicity) {
+  if (!multiplicity) {
+    return;
+  }
+
+  Tuple key(key_indices.size());
+  for (int i = 0; i < key_indices.size(); ++i) {
+    key[i] = t[key_indices[i]];
+  }
+  Value val = t[val_index];
+
+  Bucket &bucket =
+      entries.try_emplace(key, entries.get_resource()).first->second;
+  auto it = std::lower_bound(bucket.values.begin(), bucket.values.end(), val);
+  std::size_t pos = it - bucket.values.begin();
+  if (it == bucket.values.end() || *it != val) {
+    bucket.values.insert(it, val);
+    bucket.mults.insert(bucket.mults.begin() + pos, multiplicity);
+    return;
+  }
+
+  bucket.mults[pos] += multiplicity;
+  if (!bucket.mults[pos]) {
+    bucket.values.erase(it);
+    bucket.mults.erase(bucket.mults.begin() + pos);
+    if (bucket.values.empty()) {
+      entries.erase(key);
+    }
+  }
+}
+
+
+// Get the values matching a given key, or nullptr if there are none.
+const SortedIndex::Bucket *SortedIndex::lookup(const Tuple &key) const {
+  auto it = entries.find(key);
+
+  return it == entries.end() ? nullptr : &it->second;
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+// Get the attributes the index is built on.
+const Schema &SortedIndex::get_key_attrs() const {
+  return key_attrs;
+}
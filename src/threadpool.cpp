@@ -0,0 +1,135 @@
+#include <ivm/threadpool.h>
+
+
+// The number of chunks per thread a range is split into.
+const int CHUNKS_PER_THREAD = 8;
+
+
+/**
+ * Constructor
+ * =========== */
+
+// Start num_threads - 1 workers, which wait for the first batch.
+ThreadPool::ThreadPool(int num_threads) {
+  task = nullptr;
+  num_tasks = 0;
+  next_task = 0;
+  busy = 0;
+  batch = 0;
+  stopping = false;
+
+  for (int i = 1; i < num_threads; ++i) {
+    workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+
+// Tell the workers to stop, and wait for them to finish.
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  batch_ready.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Call f(i) for each i in [0, num_tasks), then return once all calls are done.
+ * The tasks are handed out one at a time to the workers and the calling thread,
+ * so uneven tasks are balanced between them.
+ */
+void ThreadPool::parallel_for(int num_tasks_,
+    const std::function<void(int)> &f) {
+  if (workers.empty() || num_tasks_ < 2) {
+    for (int i = 0; i < num_tasks_; ++i) {
+      f(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    task = &f;
+    num_tasks = num_tasks_;
+    next_task = 0;
+    busy = workers.size();
+    batch++;
+  }
+  batch_ready.notify_all();
+
+  run_tasks();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  batch_done.wait(lock, [this] { return !busy; });
+  task = nullptr;
+}
+
+
+/**
+ * Split [0, size) into contiguous chunks, several per thread so that uneven
+ * chunks balance out, and call f(chunk, begin, end) for each one on the pool.
+ */
+void ThreadPool::parallel_for_chunks(std::size_t size, 
+    const std::function<void(int, std::size_t, std::size_t)> &f) {
+  int num_chunks = get_num_chunks();
+  parallel_for(num_chunks, [&](int chunk) {
+    f(chunk, size * chunk / num_chunks, size * (chunk + 1) / num_chunks);
+  });
+}
+
+
+// Wait for batches and work on them, until the pool is destroyed.
+void ThreadPool::work() {
+  unsigned int last_batch = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      batch_ready.wait(lock, [&] { return stopping || batch != last_batch; });
+      if (stopping) {
+        return;
+      }
+      last_batch = batch;
+    }
+
+    run_tasks();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!--busy) {
+      batch_done.notify_one();
+    }
+  }
+}
+
+
+// Run tasks from the current batch until there are none left.
+void ThreadPool::run_tasks() {
+  for (int i = next_task++; i < num_tasks; i = next_task++) {
+    (*task)(i);
+  }
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+// Get the number of threads in the pool, including the calling thread.
+int ThreadPool::size() const {
+  return workers.size() + 1;
+}
+
+
+// Get the number of chunks a range is split into by parallel_for_chunks.
+int ThreadPool::get_num_chunks() const {
+  return size() * CHUNKS_PER_THREAD;
+}
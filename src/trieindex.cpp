@@ -0,0 +1,147 @@
+#include <ivm/trieindex.h>
+
+#include <algorithm>
+#include <cassert>
+
+
+// Compare two tuples lexicographically.
+static bool tuple_less(const Tuple &a, const Tuple &b) {
+  return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+
+/**
+ * Iterator
+ * ======== */
+
+// Create an iterator at the root of the trie, above the first level.
+TrieIndex::Iterator::Iterator(const TrieIndex *trie_) {
+  trie = trie_;
+  depth = -1;
+}
+
+
+/**
+ * Go down to the first value at the next level, under the current value. The
+ * range of the new node is made of the rows sharing the current value.
+ */
+void TrieIndex::Iterator::open() {
+  if (depth < 0) {
+    pos[0] = 0;
+    end[0] = trie->tuples.size();
+  } else {
+    assert(!at_end());
+    pos[depth + 1] = pos[depth];
+    end[depth + 1] = upper_bound(pos[depth], key());
+  }
+  depth++;
+}
+
+
+// Go back up to the value at the previous level.
+void TrieIndex::Iterator::up() {
+  assert(depth >= 0);
+
+  depth--;
+}
+
+
+// Move to the next distinct value at the current level.
+void TrieIndex::Iterator::next() {
+  pos[depth] = upper_bound(pos[depth], key());
+}
+
+
+/**
+ * Move to the first value at the current level that is at least v, with a
+ * binary search in the rest of the current node's range.
+ */
+void TrieIndex::Iterator::seek(Value v) {
+  int d = depth;
+  pos[d] = std::lower_bound(trie->tuples.begin() + pos[d],
+      trie->tuples.begin() + end[d], v,
+      [d](const Tuple &t, Value val) { return t[d] < val; }) -
+      trie->tuples.begin();
+}
+
+
+// Return true if there are no more values at the current level.
+bool TrieIndex::Iterator::at_end() const {
+  return pos[depth] >= end[depth];
+}
+
+
+// Get the current value.
+Value TrieIndex::Iterator::key() const {
+  return trie->tuples[pos[depth]][depth];
+}
+
+
+// Get the multiplicity of the current tuple, once all levels are open.
+LL TrieIndex::Iterator::multiplicity() const {
+  assert(depth + 1 == trie->tuples[pos[depth]].size());
+
+  return trie->mults[pos[depth]];
+}
+
+
+// Get the first row in [from, end) whose value at depth is greater than v.
+std::size_t TrieIndex::Iterator::upper_bound(std::size_t from, Value v) const {
+  int d = depth;
+  return std::upper_bound(trie->tuples.begin() + from,
+      trie->tuples.begin() + end[d], v,
+      [d](Value val, const Tuple &t) { return val < t[d]; }) -
+      trie->tuples.begin();
+}
+
+
+/**
+ * Constructor
+ * =========== */
+
+// Initialise an empty trie, allocated from the given memory resource.
+TrieIndex::TrieIndex(std::pmr::memory_resource *resource) : tuples(resource),
+    mults(resource) {}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Update the trie after a tuple's multiplicity changed in the relation. A new
+ * tuple is inserted at its place in the order, and a tuple whose multiplicity
+ * drops to 0 is removed.
+ */
+void TrieIndex::update_tuple(const Tuple &t, LL multiplicity) {
+  auto it = std::lower_bound(tuples.begin(), tuples.end(), t, tuple_less);
+  std::size_t row = it - tuples.begin();
+
+  if (it == tuples.end() || *it != t) {
+    tuples.insert(it, t);
+    mults.insert(mults.begin() + row, multiplicity);
+    return;
+  }
+
+  mults[row] += multiplicity;
+  if (!mults[row]) {
+    tuples.erase(it);
+    mults.erase(mults.begin() + row);
+  }
+}
+
+
+// Get an iterator at the root of the trie.
+TrieIndex::Iterator TrieIndex::root() const {
+  return Iterator(this);
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+// Return true if the trie contains no tuples.
+bool TrieIndex::empty() const {
+  return tuples.empty();
+}
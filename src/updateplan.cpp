@@ -0,0 +1,84 @@
+#include <ivm/updateplan.h>
+
+
+/**
+ * Constructor
+ * =========== */
+
+/**
+ * Compile the plan for updates to a given relation, by looking up once where
+ * each attribute of the other relations is found in the updated relation.
+ */
+UpdatePlan::UpdatePlan(const std::vector<Relation> &rels, int rel_num_) {
+  rel_num = rel_num_;
+  int n = rels.size();
+  const std::map<std::string, int> &sm = rels[rel_num].get_schema_map();
+
+  key_positions.resize(n);
+  missing_slots.assign(n, -1);
+  shared_attrs.resize(n);
+  for (int i = 0; i < n; ++i) {
+    if (i == rel_num) {
+      continue;
+    }
+    const Schema &schema = rels[i].get_schema();
+    for (int j = 0; j < schema.size(); ++j) {
+      auto it = sm.find(schema[j]);
+      if (it == sm.end()) {
+        missing_slots[i] = j;
+        key_positions[i].push_back(-1);
+      } else {
+        key_positions[i].push_back(it->second);
+        shared_attrs[i].push_back(schema[j]);
+      }
+    }
+  }
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Fill the keys of the other relations with the values of an update tuple, and
+ * clear their missing slots. Each key must already have the right size.
+ */
+void UpdatePlan::fill_keys(const Tuple &t, std::vector<Tuple> &keys) const {
+  for (int i = 0; i < key_positions.size(); ++i) {
+    const std::vector<int> &positions = key_positions[i];
+    for (int j = 0; j < positions.size(); ++j) {
+      keys[i][j] = positions[j] < 0 ? 0 : t[positions[j]];
+    }
+  }
+}
+
+
+/**
+ * Fill the key of a relation on the attributes it shares with the updated one,
+ * which is its key without the missing slot. The key must have the right size.
+ */
+void UpdatePlan::fill_shared_key(const Tuple &t, int i, Tuple &key) const {
+  const std::vector<int> &positions = key_positions[i];
+  for (int j = 0, k = 0; j < positions.size(); ++j) {
+    if (positions[j] >= 0) {
+      key[k++] = t[positions[j]];
+    }
+  }
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+// Get the position of the missing attribute in a relation's key.
+int UpdatePlan::get_missing_slot(int i) const {
+  return missing_slots[i];
+}
+
+
+// Get the attributes a relation shares with the updated one.
+const Schema &UpdatePlan::get_shared_attrs(int i) const {
+  return shared_attrs[i];
+}
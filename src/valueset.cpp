@@ -0,0 +1,104 @@
+#include <ivm/valueset.h>
+
+#include <cassert>
+
+
+/**
+ * Constructor
+ * =========== */
+
+// Initialise an empty set, allocated from the given memory resource.
+ValueSet::ValueSet(bool dense_, std::pmr::memory_resource *resource) : 
+    members(resource), counts(resource), positions(resource), 
+    position_map(resource) {
+  dense = dense_;
+}
+
+
+/**
+ * Operations
+ * ========== */
+
+/**
+ * Add an occurrence of a value, adding the value if it is not in the set yet.
+ * For dense sets, the position array grows to cover the largest value inserted
+ * so far.
+ */
+void ValueSet::insert(Value v) {
+  int pos;
+  if (dense) {
+    if ((std::size_t)v >= positions.size()) {
+      positions.resize(v + 1, -1);
+    }
+    if (positions[v] < 0) {
+      positions[v] = members.size();
+    }
+    pos = positions[v];
+  } else {
+    pos = position_map.try_emplace(v, members.size()).first->second;
+  }
+
+  if ((std::size_t)pos == members.size()) {
+    members.push_back(v);
+    counts.push_back(0);
+  }
+  counts[pos]++;
+}
+
+
+/**
+ * Remove an occurrence of a value, which must be in the set. When the last one
+ * is removed, the value leaves the set, and the last member takes its place.
+ */
+void ValueSet::erase(Value v) {
+  int pos = dense ? positions[v] : position_map.find(v)->second;
+  assert(pos >= 0);
+
+  if (--counts[pos]) {
+    return;
+  }
+
+  // Move the last member into the freed position.
+  Value last = members.back();
+  members[pos] = last;
+  counts[pos] = counts.back();
+  members.pop_back();
+  counts.pop_back();
+  if (dense) {
+    positions[last] = pos;
+    positions[v] = -1;
+  } else {
+    position_map.find(last)->second = pos;
+    position_map.erase(v);
+  }
+}
+
+
+/**
+ * Accessors
+ * ========= */
+
+// Return true if the value is in the set.
+bool ValueSet::contains(Value v) const {
+  if (dense) {
+    return (std::size_t)v < positions.size() && positions[v] >= 0;
+  }
+
+  return position_map.count(v);
+}
+
+
+// Get the number of values in the set.
+std::size_t ValueSet::size() const {
+  return members.size();
+}
+
+
+ValueSet::const_iterator ValueSet::begin() const {
+  return members.begin();
+}
+
+
+ValueSet::const_iterator ValueSet::end() const {
+  return members.end();
+}
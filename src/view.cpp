@@ -5,26 +5,70 @@
  * Constructor
  * =========== */
 
-// Initialise the relation and the set of values.
-View::View(const Schema &schema_) : Relation(schema_), 
-    existing_values(schema_.size(), std::unordered_set<LL>()) {}
+// Initialise the relation, using the given resource.
+View::View(const Schema &schema_, std::pmr::memory_resource *resource) : 
+    Relation(schema_, resource) {
+  has_pending = false;
+}
 
 
 /**
  * Operations
  * ========== */
 
-// Add the values of a tuple to the sets of values.
-void View::add_values(const Tuple &t) {
-  for (int i = 0; i < schema_size; ++i) {
-    existing_values[i].insert(t[i]);
+// Update a tuple.
+void View::update_tuple(const Tuple &t, LL multiplicity) {
+  Relation::update_tuple(t, multiplicity);
+}
+
+
+/**
+ * Start keeping a log of updates to relations with the given schemas, with one
+ * delta relation per relation, allocated from the view's resource.
+ */
+void View::add_update_log(const std::vector<Schema> &rel_schemas) {
+  for (const auto &rel_schema : rel_schemas) {
+    pending.push_back(Relation(rel_schema, entries.get_resource()));
   }
+  pending_index_attrs.resize(rel_schemas.size());
+  pending_index_nums.resize(rel_schemas.size(), -1);
 }
 
 
-// Update a tuple.
-void View::update_tuple(const Tuple &t, int multiplicity) {
-  Relation::update_tuple(t, multiplicity);
+/**
+ * Register an index on the given attributes of the delta relation holding the
+ * logged updates to a relation, which is kept when the log is emptied.
+ */
+int View::add_pending_index(int rel_num, const Schema &key_attrs) {
+  pending_index_attrs[rel_num] = key_attrs;
+  pending_index_nums[rel_num] = pending[rel_num].add_index(key_attrs);
+
+  return pending_index_nums[rel_num];
+}
+
+
+// Log an update to a relation, coalescing it with the earlier ones.
+void View::log_update(int rel_num, const Tuple &t, LL multiplicity) {
+  pending[rel_num].update_tuple(t, multiplicity);
+  has_pending = true;
+}
+
+
+/**
+ * Empty the log by replacing each non-empty delta relation with a new one, and
+ * registering its index again.
+ */
+void View::clear_pending_updates() {
+  for (int i = 0; i < pending.size(); ++i) {
+    if (pending[i].empty()) {
+      continue;
+    }
+    pending[i] = Relation(pending[i].get_schema(), entries.get_resource());
+    if (pending_index_nums[i] >= 0) {
+      pending_index_nums[i] = pending[i].add_index(pending_index_attrs[i]);
+    }
+  }
+  has_pending = false;
 }
 
 
@@ -32,7 +76,20 @@ void View::update_tuple(const Tuple &t, int multiplicity) {
  * Accessors
  * ========= */
 
-// Get the set of values for a given attribute.
-std::unordered_set<LL> View::get_existing_values(int attr_index) const {
-  return existing_values[attr_index];
-}
\ No newline at end of file
+// Return true if the log holds updates not reflected in the view.
+bool View::has_pending_updates() const {
+  return has_pending;
+}
+
+
+// Get the net change of a relation not reflected in the view.
+const Relation &View::get_pending_updates(int rel_num) const {
+  return pending[rel_num];
+}
+
+
+// Get the logged updates to a relation matching a key of its index.
+const SecondaryIndex::Bucket *View::lookup_pending(int rel_num, 
+    const Tuple &key) const {
+  return pending[rel_num].get_index(pending_index_nums[rel_num]).lookup(key);
+}
@@ -11,16 +11,49 @@
 /**
  * Initialise a view processor with n relations and n views, one per relation,
  * such that each view allows O(1) count re-computation under updates
- * to its corresponding relation.
+ * to its corresponding relation. Each relation gets an index on the attributes
+ * it shares with each other one, which gives the values of the missing
+ * attribute matching an update to that one. If the views are maintained
+ * lazily, each view also gets a log of the updates to the other relations.
  */
-ViewProcessor::ViewProcessor(int n_) : DeltaProcessor(n_) {
+ViewProcessor::ViewProcessor(int n_, const Options &options_) : 
+    DeltaProcessor(n_, options_) {
   Schema schema(n - 1);
+  views.reserve(n);
   for (int i = 0; i < n; ++i) {
     for (int j = 1; j < n; ++j) {
       int idx = i + j > n ? (i + j) % n : i + j;
       schema[j - 1] = "A" + std::to_string(idx);
     }
-    views.push_back(View(schema));
+    views.push_back(View(schema, &storage_pool));
+  }
+
+  shared_indexes.assign(n, std::vector<int>(n, -1));
+  for (int r = 0; r < n; ++r) {
+    for (int k = 0; k < n; ++k) {
+      if (k != r) {
+        shared_indexes[r][k] = rels[k].add_index(plans[r].get_shared_attrs(k));
+      }
+    }
+  }
+  matches.assign(n, nullptr);
+
+  /**
+   * The logged updates to the second relation after a view's are looked up on
+   * the attributes shared with the first one, see fold_update.
+   */
+  if (options.lazy_views) {
+    std::vector<Schema> rel_schemas;
+    for (const auto &rel : rels) {
+      rel_schemas.push_back(rel.get_schema());
+    }
+    for (int i = 0; i < n; ++i) {
+      views[i].add_update_log(rel_schemas);
+      int first_rel_num = (i + 1) % n;
+      int second_rel_num = (i + 2) % n;
+      views[i].add_pending_index(second_rel_num, 
+          plans[first_rel_num].get_shared_attrs(second_rel_num));
+    }
   }
 }
 
@@ -33,46 +66,197 @@ ViewProcessor::ViewProcessor(int n_) : DeltaProcessor(n_) {
  * Given an update to a relation, update the current count using the view that
  * corresponds to the updated relation, then also maintain all views affected
  * by the update, i.e. all other views, and return the updated count.
+ *
+ * If the views are maintained lazily, the view of the updated relation is first
+ * brought up to date, and the update is only logged for the other views.
  */
 LL ViewProcessor::update_and_count(int rel_num, const Tuple &t, 
     int multiplicity) {
+  if (options.lazy_views) {
+    fold_view(rel_num);
+    current_count += multiplicity * views[rel_num].get_multiplicity(t);
+    update_rel(rel_num, t, multiplicity);
+    for (int i = 0; i < n; ++i) {
+      if (i != rel_num) {
+        views[i].log_update(rel_num, t, multiplicity);
+      }
+    }
+    return current_count;
+  }
+
   // Update the count using the relation's view.
   current_count += multiplicity * views[rel_num].get_multiplicity(t);
   // Update the relation.
   update_rel(rel_num, t, multiplicity);
 
-  bool is_new_tuple = (rels[rel_num].get_multiplicity(t) == multiplicity);
+  update_views(rel_num, t, multiplicity);
+
+  return current_count;
+}
+
+
+/**
+ * Given a batch of updates to a relation, merge them into a delta relation and
+ * use it to update the current count and the relation, then maintain each
+ * other view with the join of the delta relation with all the relations the
+ * view is computed from, and return the updated count.
+ *
+ * Like in delta processing, this join is computed as a chain of joins, each
+ * aggregated by the attributes of the view and of the relations joined after
+ * it, so that the lookups in the rest of the chain are shared by delta tuples.
+ */
+LL ViewProcessor::update_and_count_batch(int rel_num, 
+    const UpdateBatch &batch) {
+  // Free the temporary relations of the previous update.
+  scratch_arena.reset();
+
+  Relation delta_rel = coalesce_batch(rel_num, batch, &scratch_arena);
+  if (delta_rel.empty()) {
+    return current_count;
+  }
+
+  if (options.lazy_views) {
+    fold_view(rel_num);
+  }
+  delta_rel.for_each_entry([&](const Tuple &t, LL mult) {
+    current_count += mult * views[rel_num].get_multiplicity(t);
+    update_rel(rel_num, t, mult);
+  });
+
+  if (options.lazy_views) {
+    delta_rel.for_each_entry([&](const Tuple &t, LL mult) {
+      for (int i = 0; i < n; ++i) {
+        if (i != rel_num) {
+          views[i].log_update(rel_num, t, mult);
+        }
+      }
+    });
+    return current_count;
+  }
+
+  for (int i = 0; i < n; ++i) {
+    if (i == rel_num) {
+      continue;
+    }
+
+    // Get the relations the view is computed from, following the cycle.
+    std::vector<int> chain;
+    for (int k = 1; k < n; ++k) {
+      if ((rel_num + k) % n != i) {
+        chain.push_back((rel_num + k) % n);
+      }
+    }
+    // Get the attributes of the view and of the relations after each one.
+    std::vector<Schema> group_schemas(chain.size());
+    Schema group_schema = views[i].get_schema();
+    for (int k = chain.size() - 1; k >= 0; --k) {
+      group_schemas[k] = group_schema;
+      group_schema = HelperFunctions::schema_union(group_schema, 
+          rels[chain[k]].get_schema());
+    }
+
+    // The first relation is probed through an index registered on first use.
+    rels[chain[0]].add_index(HelperFunctions::schema_intersection(
+        rels[rel_num].get_schema(), rels[chain[0]].get_schema()));
+    Relation view_delta = delta_rel.join_group_by(rels[chain[0]], 
+        group_schemas[0], &scratch_arena, &pool);
+    for (int k = 1; k < chain.size(); ++k) {
+      view_delta = view_delta.join_group_by(rels[chain[k]], group_schemas[k], 
+          &scratch_arena, &pool);
+    }
 
-  views[rel_num].add_values(t);
-  update_views(rel_num, t, multiplicity, is_new_tuple);
+    view_delta.for_each_entry([&](const Tuple &t, LL mult) {
+      views[i].update_tuple(t, mult);
+    });
+  }
 
   return current_count;
 }
 
 
+/**
+ * Look up the tuples of each relation other than the updated one which match
+ * an update tuple, through the index on the attributes they share. Only the
+ * values of the missing attribute in these tuples can extend the update tuple.
+ */
+void ViewProcessor::find_matches(int rel_num, const Tuple &t) {
+  Tuple shared_key(n - 2);
+  for (int k = 0; k < n; ++k) {
+    if (k == rel_num) {
+      continue;
+    }
+    plans[rel_num].fill_shared_key(t, k, shared_key);
+    matches[k] = rels[k].get_index(shared_indexes[rel_num][k]).lookup(
+        shared_key);
+  }
+}
+
+
+/**
+ * Get the relation, other than the updated one and the one of a view, with the
+ * fewest tuples matching the update, whose values of the missing attribute are
+ * the candidates to go through when maintaining the view. Return -1 if one of
+ * the relations has no matching tuples, in which case the view does not change.
+ */
+int ViewProcessor::get_candidate_rel(int rel_num, int view_num) const {
+  int candidate_rel_num = -1;
+  for (int k = 0; k < n; ++k) {
+    if (k == rel_num || k == view_num) {
+      continue;
+    }
+    if (!matches[k]) {
+      return -1;
+    }
+    if (candidate_rel_num < 0 || 
+        matches[k]->size() < matches[candidate_rel_num]->size()) {
+      candidate_rel_num = k;
+    }
+  }
+
+  return candidate_rel_num;
+}
+
+
 /**
  * Update all views affected by an update to a relation. In the case of the
  * query class described in the exam problem statement, this means updating all
  * n-1 views corresponding to the all relations other than the updated one.
+ *
+ * For each view, the values of the missing attribute which can change it are
+ * those found in the tuples matching the update in every relation the view is
+ * computed from, so they are taken from the relation with the fewest matching
+ * tuples, and the other relations are probed for each of them.
  */
 void ViewProcessor::update_views(int rel_num, const Tuple &t, 
-    int multiplicity, bool is_new_tuple) {
-  // Get the attribute that is missing in the updated relation.
-  std::string missing_attr = rel_num == 0 ? 
-      "A" + std::to_string(n) : "A" + std::to_string(rel_num);
-  // Get the keys used to search in the other views.
-  std::vector<std::pair<Tuple, int> > keys = HelperFunctions::generate_keys(
-      rels, t, rel_num, missing_attr);
-
-  // Get the values for the missing attribute for each other view.
-  std::vector<std::unordered_set<LL> > vals(n);
-  for (int i = 0; i < n; ++i) {
-    if (i == rel_num) {
-      continue;
+    int multiplicity) {
+  // Fill the keys used to search in the other views.
+  const UpdatePlan &plan = plans[rel_num];
+  plan.fill_keys(t, keys);
+  find_matches(rel_num, t);
+
+  /**
+   * Get the multiplicity difference for a value of the missing attribute in a
+   * view, given the count of its tuples in the candidate relation, filling the
+   * keys of the other relations with it.
+   */
+  auto probe = [&](std::vector<Tuple> &keys, int i, int candidate_rel_num,
+      Value v, LL delta_count) {
+    // Go through each other relation to perform a delta update to the view.
+    for (int j = 0; j < n; ++j) {
+      if (j == i || j == rel_num || j == candidate_rel_num) {
+        continue;
+      }
+      // Fill the empty slot in the key.
+      keys[j][plan.get_missing_slot(j)] = v;
+      // Get the count for the constructed tuple.
+      delta_count *= rels[j].get_multiplicity(keys[j]);
+      // Stop if the count becomes 0.
+      if (!delta_count) {
+        break;
+      }
     }
-    vals[i] = views[i].get_existing_values(
-        rels[i].get_schema_map()[missing_attr]);
-  }
+    return delta_count;
+  };
 
   // Go through each view and update it.
   for (int i = 0; i < n; ++i) {
@@ -81,33 +265,193 @@ void ViewProcessor::update_views(int rel_num, const Tuple &t,
       continue;
     }
 
-    // Go through the values for the missing attribute in the current view.
-    for (auto v : vals[i]) {
-      // The multiplicity difference.
-      LL delta_count = multiplicity;
+    int candidate_rel_num = get_candidate_rel(rel_num, i);
+    if (candidate_rel_num < 0) {
+      continue;
+    }
+    const SecondaryIndex::Bucket &candidates = *matches[candidate_rel_num];
+    int slot = plan.get_missing_slot(i);
+
+    /**
+     * If there are many values to go through, split them between the threads.
+     * Each chunk of values is probed with its own keys, and collects its view
+     * updates separately, which are then applied one chunk after the other.
+     */
+    if (pool.size() > 1 && candidates.size() >= options.parallel_threshold) {
+      std::vector<std::pair<Value, LL> > fanout;
+      fanout.reserve(candidates.size());
+      for (const auto &e : candidates) {
+        fanout.emplace_back(e.first[0], e.second);
+      }
 
-      // Go through each other relation to perform a delta update to the view.
-      for (int j = 0; j < n; ++j) {
-        if (j == i || j == rel_num) {
-          continue;
+      std::vector<std::vector<std::pair<Tuple, LL> > > chunk_updates(
+          pool.get_num_chunks());
+      pool.parallel_for_chunks(fanout.size(), 
+          [&](int chunk, std::size_t begin, std::size_t end) {
+        std::vector<Tuple> chunk_keys = keys;
+        for (std::size_t k = begin; k < end; ++k) {
+          Value v = fanout[k].first;
+          LL delta_count = probe(chunk_keys, i, candidate_rel_num, v, 
+              multiplicity * fanout[k].second);
+          if (delta_count) {
+            chunk_keys[i][slot] = v;
+            chunk_updates[chunk].emplace_back(chunk_keys[i], delta_count);
+          }
         }
-        // Fill the empty slot in the key.
-        keys[j].first[keys[j].second] = v;
-        // Get the count for the constructed tuple.
-        delta_count *= rels[j].get_multiplicity(keys[j].first);
-        // Stop if the count becomes 0.
-        if (!delta_count) {
-          break;
+      });
+      for (const auto &updates : chunk_updates) {
+        for (const auto &update : updates) {
+          views[i].update_tuple(update.first, update.second);
         }
       }
-      keys[i].first[keys[i].second] = v;
+      continue;
+    }
+
+    // Go through the candidate values for the missing attribute.
+    for (const auto &e : candidates) {
+      Value v = e.first[0];
+      LL delta_count = probe(keys, i, candidate_rel_num, v, 
+          multiplicity * e.second);
       if (delta_count) {
-        views[i].update_tuple(keys[i].first, delta_count);
+        keys[i][slot] = v;
+        views[i].update_tuple(keys[i], delta_count);
+      }
+    }
+  }
+}
+
+
+/**
+ * Bring a lazily maintained view up to date with the updates logged for it.
+ * Since the view is a join, its change only depends on the net change of each
+ * relation it is computed from, whatever the order of the updates was. Taking
+ * the relations in the order of the cycle from the view's, the change is the
+ * sum, for each relation, of the join of its logged updates with the current
+ * contents of the relations before it, and the contents of the relations after
+ * it before their logged updates.
+ */
+void ViewProcessor::fold_view(int view_num) {
+  View &view = views[view_num];
+  if (!view.has_pending_updates()) {
+    return;
+  }
+
+  for (int l = 1; l < n; ++l) {
+    int rel_num = (view_num + l) % n;
+    view.get_pending_updates(rel_num).for_each_entry(
+        [&](const Tuple &t, LL mult) {
+      fold_update(view_num, rel_num, t, mult);
+    });
+  }
+  view.clear_pending_updates();
+}
+
+
+/**
+ * Apply to a view the change produced by a logged update to a relation, given
+ * the current contents of the relations before it in the order of the cycle
+ * from the view's relation, and the old contents of the relations after it.
+ *
+ * The candidate values of the missing attribute are taken from the current
+ * relation with the fewest tuples matching the update, as in update_views.
+ * For the first relation after the view's, all the others are old, so they
+ * are taken from the second relation after the view's, as the values matching
+ * the update either in its current contents or in its logged updates.
+ */
+void ViewProcessor::fold_update(int view_num, int rel_num, const Tuple &t, 
+    LL multiplicity) {
+  View &view = views[view_num];
+  const UpdatePlan &plan = plans[rel_num];
+  plan.fill_keys(t, keys);
+
+  // Get the multiplicity of a key in a relation, old or current.
+  int rel_pos = (rel_num - view_num + n) % n;
+  auto is_old = [&](int j) {
+    return (j - view_num + n) % n > rel_pos;
+  };
+  auto get_multiplicity = [&](int j, const Tuple &key) {
+    LL mult = rels[j].get_multiplicity(key);
+    if (is_old(j)) {
+      mult -= view.get_pending_updates(j).get_multiplicity(key);
+    }
+    return mult;
+  };
+
+  // Find the current relation with the fewest tuples matching the update.
+  Tuple shared_key(n - 2);
+  const SecondaryIndex::Bucket *candidates = nullptr;
+  int candidate_rel_num = -1;
+  for (int j = 0; j < n; ++j) {
+    if (j == view_num || j == rel_num || is_old(j)) {
+      continue;
+    }
+    plan.fill_shared_key(t, j, shared_key);
+    const SecondaryIndex::Bucket *bucket = 
+        rels[j].get_index(shared_indexes[rel_num][j]).lookup(shared_key);
+    if (!bucket) {
+      return;
+    }
+    if (!candidates || bucket->size() < candidates->size()) {
+      candidates = bucket;
+      candidate_rel_num = j;
+    }
+  }
+
+  fold_candidates.clear();
+  if (candidates) {
+    for (const auto &e : *candidates) {
+      fold_candidates.emplace_back(e.first[0], e.second);
+    }
+  } else {
+    candidate_rel_num = (view_num + 2) % n;
+    int slot = plan.get_missing_slot(candidate_rel_num);
+    Tuple &key = keys[candidate_rel_num];
+    auto add_candidate = [&](Value v) {
+      key[slot] = v;
+      LL mult = get_multiplicity(candidate_rel_num, key);
+      if (mult) {
+        fold_candidates.emplace_back(v, mult);
+      }
+    };
+
+    plan.fill_shared_key(t, candidate_rel_num, shared_key);
+    const SecondaryIndex::Bucket *current = rels[candidate_rel_num].get_index(
+        shared_indexes[rel_num][candidate_rel_num]).lookup(shared_key);
+    const SecondaryIndex::Bucket *logged = 
+        view.lookup_pending(candidate_rel_num, shared_key);
+    if (current) {
+      for (const auto &e : *current) {
+        add_candidate(e.first[0]);
+      }
+    }
+    if (logged) {
+      for (const auto &e : *logged) {
+        if (!current || current->find(e.first) == current->end()) {
+          add_candidate(e.first[0]);
+        }
+      }
+    }
+  }
+
+  int view_slot = plan.get_missing_slot(view_num);
+  for (const auto &c : fold_candidates) {
+    LL delta_count = multiplicity * c.second;
+
+    // Go through each other relation the view is computed from.
+    for (int j = 0; j < n; ++j) {
+      if (j == view_num || j == rel_num || j == candidate_rel_num) {
+        continue;
       }
-      // If the update contained a new tuple, then update the value sets too.
-      if (is_new_tuple) {
-        views[i].add_values(keys[i].first);
+      keys[j][plan.get_missing_slot(j)] = c.first;
+      delta_count *= get_multiplicity(j, keys[j]);
+      if (!delta_count) {
+        break;
       }
     }
+
+    if (delta_count) {
+      keys[view_num][view_slot] = c.first;
+      view.update_tuple(keys[view_num], delta_count);
+    }
   }
-}
\ No newline at end of file
+}